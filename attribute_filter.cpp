@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file attribute_filter.cpp
+ * @brief Attribute filters of an image through its tree of level lines
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "attribute_filter.h"
+#include "tree_reduce.h"
+#include "label_map.h"
+#include "io_png.h"
+#include <algorithm>
+#include <sstream>
+#include <cmath>
+
+/// Area enclosed by a closed polygonal line.
+static double area(const std::vector<Point>& line) {
+    double a=0;
+    for(size_t i=0, j=line.size()-1; i<line.size(); j=i++)
+        a += (double)line[j].x*line[i].y - (double)line[i].x*line[j].y;
+    return std::abs(a)/2;
+}
+
+/// Range of levels [first,second] of a set of nodes.
+typedef std::pair<pt_t,pt_t> Range;
+
+struct RangeInit {
+    Range operator()(const LLTree::Node& n) const {
+        return Range(n.ll->level, n.ll->level);
+    }
+};
+struct RangeMerge {
+    void operator()(Range& r, const Range& c) const {
+        r.first  = std::min(r.first, c.first);
+        r.second = std::max(r.second,c.second);
+    }
+};
+
+/// Compute an attribute at each node of the tree.
+/// The area is the one enclosed by the level line. The persistence is the
+/// maximal level difference between the level line of the parent (or the node
+/// itself if it is a root) and the level lines inside the node.
+void compute_attribute(LLTree& tree, Attribute a, std::vector<double>& attr) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const int n = (int)nodes.size();
+    attr.resize(n);
+    if(a == AREA) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+        for(int i=0; i<n; i++)
+            attr[i] = area(nodes[i].ll->line);
+        return;
+    }
+    std::vector<Range> range;
+    reduce_up(tree, range, RangeInit(), RangeMerge());
+    for(int i=0; i<n; i++) {
+        pt_t ref = (nodes[i].parent? nodes[i].parent: &nodes[i])->ll->level;
+        attr[i] = std::max(ref-range[i].first, range[i].second-ref);
+    }
+}
+
+/// Write image to file prefix<k>.png. Concurrent calls may clear \a ok.
+void PngProfileSink::operator()(size_t k, double /*threshold*/,
+                                const unsigned char* im, size_t w, size_t h) {
+    std::ostringstream s;
+    s << prefix << k << ".png";
+    if(io_png_write_u8(s.str().c_str(), im, w, h, 1) != 0) {
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+        ok = false;
+    }
+}
+
+/// Attribute of a node, made decreasing along the tree (min rule): a node
+/// is removed as soon as one of its ancestors is.
+struct MinRuleRoot {
+    const std::vector<double>& attr;
+    const LLTree::Node* base;
+    MinRuleRoot(const std::vector<double>& a, const LLTree::Node* b)
+    : attr(a), base(b) {}
+    double operator()(const LLTree::Node& n) const { return attr[&n-base]; }
+};
+struct MinRuleDown {
+    const std::vector<double>& attr;
+    const LLTree::Node* base;
+    MinRuleDown(const std::vector<double>& a, const LLTree::Node* b)
+    : attr(a), base(b) {}
+    double operator()(double p, const LLTree::Node& n) const {
+        return std::min(p, attr[&n-base]);
+    }
+};
+
+/// Compute the profile of attribute filters at given thresholds.
+/// \param tree the tree of level lines of the image.
+/// \param im the image.
+/// \param w,h the dimensions of \a im.
+/// \param attr the attribute of each node (see compute_attribute).
+/// \param thresholds the list of thresholds, in any order.
+/// \param sink receives each filtered image, with the index in \a thresholds.
+/// For threshold t, a node whose attribute (or the one of an ancestor) is less
+/// than t is removed. A pixel whose innermost node is removed takes the level
+/// of the outermost removed node containing it; other pixels are unchanged.
+/// Nodes are sorted only once by attribute, from which all thresholds are
+/// handled in a single top-down pass over the tree. The images are output in
+/// parallel, so \a sink may be called concurrently.
+void attribute_profile(LLTree& tree, const unsigned char* im,
+                       size_t w, size_t h,
+                       const std::vector<double>& attr,
+                       const std::vector<double>& thresholds,
+                       ProfileSink& sink) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const size_t n=nodes.size(), K=thresholds.size();
+    if(K == 0)
+        return;
+    // Sorted sweep: node is kept for sorted thresholds of index below kmin
+    std::vector<double> eff;
+    if(n > 0) {
+        const LLTree::Node* base = &nodes[0];
+        reduce_down(tree, eff, MinRuleRoot(attr,base), MinRuleDown(attr,base));
+    }
+    std::vector<double> sorted(thresholds);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<size_t> order(K); // Index of each threshold in sorted
+    for(size_t k=0; k<K; k++)
+        order[k] = std::lower_bound(sorted.begin(), sorted.end(),
+                                    thresholds[k]) - sorted.begin();
+    std::vector<size_t> kmin(n);
+    for(size_t i=0; i<n; i++)
+        kmin[i] = std::upper_bound(sorted.begin(), sorted.end(), eff[i])
+            - sorted.begin();
+    // Outermost removed node containing each node, for sorted thresholds of
+    // index k>=kmin, in pre-order so that the parent is known first
+    std::vector<size_t> outer(n*K);
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it) {
+        const size_t i = &*it-&nodes[0];
+        const size_t j = it->parent? it->parent-&nodes[0]: i;
+        for(size_t k=kmin[i]; k<K; k++)
+            outer[i*K+k] = (j==i || k<kmin[j])? i: outer[j*K+k];
+    }
+    // Level of flattening for each (node, sorted threshold), -1 if kept
+    std::vector<short> flat(n*K, -1);
+    for(size_t i=0; i<n; i++)
+        for(size_t k=kmin[i]; k<K; k++)
+            flat[i*K+k] = (short)(nodes[outer[i*K+k]].ll->level+0.5f);
+    outer.clear();
+    // Innermost node of each pixel (0 if none)
+    std::vector<unsigned int> label;
+    label_map(tree, w, h, label);
+    // Synthesize and output filtered images
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<unsigned char> out(w*h);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for(int k=0; k<(int)K; k++) {
+            const size_t ks = order[k];
+            for(size_t i=0; i<w*h; i++) {
+                short v = label[i]? flat[(label[i]-1)*K+ks]: -1;
+                out[i] = (v<0)? im[i]: (unsigned char)v;
+            }
+            sink(k, thresholds[k], &out[0], w, h);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file attribute_filter.h
+ * @brief Attribute filters of an image through its tree of level lines
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef ATTRIBUTE_FILTER_H
+#define ATTRIBUTE_FILTER_H
+
+#include "lltree.h"
+#include <string>
+
+typedef enum {AREA, PERSISTENCE} Attribute;
+
+void compute_attribute(LLTree& tree, Attribute a, std::vector<double>& attr);
+
+/// Receive the filtered images of an attribute profile.
+struct ProfileSink {
+    virtual ~ProfileSink() {}
+    /// Filtered image of index \a k. Can be called concurrently from several
+    /// threads, \a im is valid only during the call.
+    virtual void operator()(size_t k, double threshold,
+                            const unsigned char* im, size_t w, size_t h)=0;
+};
+
+/// Write each filtered image to PNG file prefix<k>.png.
+struct PngProfileSink : public ProfileSink {
+    std::string prefix;
+    bool ok; ///< Were all images written successfully? Written atomically
+    PngProfileSink(const std::string& p): prefix(p), ok(true) {}
+    void operator()(size_t k, double threshold,
+                    const unsigned char* im, size_t w, size_t h);
+};
+
+void attribute_profile(LLTree& tree, const unsigned char* im,
+                       size_t w, size_t h,
+                       const std::vector<double>& attr,
+                       const std::vector<double>& thresholds,
+                       ProfileSink& sink);
+
+#endif
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file bilinear.cpp
+ * @brief Evaluation of the bilinear interpolation of an image
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifdef BILINEAR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+/// Index of top-left data point of the sample square containing abscissa \a x
+/// (clamped inside [0,w-1]) and position \a fx inside the square.
+inline size_t bilinear_cell(pt_t x, size_t w, pt_t& fx) {
+    x = std::max((pt_t)0, std::min((pt_t)(w-1), x));
+    size_t i = std::min((size_t)x, w-2);
+    fx = x-(pt_t)i;
+    return i;
+}
+
+/// Value at \a p of the bilinear interpolation of image \a im of size \a w x
+/// \a h, both at least 2. Outside the image, the nearest border value is used.
+template <typename T>
+float bilinear(const T* im, size_t w, size_t h, const Point& p) {
+    assert(w>=2 && h>=2);
+    pt_t fx, fy;
+    size_t i = bilinear_cell(p.y,h,fy)*w + bilinear_cell(p.x,w,fx);
+    float a=im[i], b=im[i+1], c=im[i+w], d=im[i+w+1];
+    return (1-fy)*((1-fx)*a+fx*b) + fy*((1-fx)*c+fx*d);
+}
+
+/// Evaluate the bilinear interpolation at an array of points.
+/// \param im,w,h the image, of size at least 2x2.
+/// \param p the array of points.
+/// \param n the number of points.
+/// \param[out] out the array of values, of size \a n.
+/// Points are handled by blocks: positions are first converted to indices and
+/// weights, then data are gathered, two loops the compiler can vectorize.
+/// Large batches are split among threads.
+template <typename T>
+void bilinear(const T* im, size_t w, size_t h,
+              const Point* p, size_t n, float* out) {
+    assert(w>=2 && h>=2);
+    const int B=256; // Block size
+    const int nb = (int)((n+B-1)/B);
+#ifdef _OPENMP
+#pragma omp parallel for if(n>=64*B)
+#endif
+    for(int b=0; b<nb; b++) {
+        size_t idx[B];
+        pt_t fx[B], fy[B];
+        const size_t i0=b*(size_t)B, m=std::min(n-i0,(size_t)B);
+        for(size_t i=0; i<m; i++)
+            idx[i] = bilinear_cell(p[i0+i].y,h,fy[i])*w
+                   + bilinear_cell(p[i0+i].x,w,fx[i]);
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+        for(size_t i=0; i<m; i++) {
+            const T* q = im+idx[i];
+            float a=q[0], b=q[1], c=q[w], d=q[w+1];
+            out[i0+i] = (1-fy[i])*((1-fx[i])*a+fx[i]*b)
+                      +     fy[i] *((1-fx[i])*c+fx[i]*d);
+        }
+    }
+}
+
+/// Mean contrast along each level line of the tree.
+/// \param tree the tree of level lines of \a im.
+/// \param im,w,h the image.
+/// \param[out] contrast the contrast of each node, indexed as tree nodes.
+/// \param dist distance to the line of the sampling points.
+/// At each vertex of the line, the image is sampled at distance \a dist on
+/// both sides along the normal. The contrast is the mean absolute difference
+/// of these values. The closing vertex, repeated at the end of the line, is
+/// counted once.
+template <typename T>
+void mean_contrast(LLTree& tree, const T* im, size_t w, size_t h,
+                   std::vector<double>& contrast, pt_t dist) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const int n = (int)nodes.size();
+    contrast.assign(n, 0);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<Point> samples;
+        std::vector<float> values;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64)
+#endif
+        for(int i=0; i<n; i++) {
+            const std::vector<Point>& line = nodes[i].ll->line;
+            if(line.size() < 3)
+                continue;
+            const size_t m=line.size()-1; // Closed line: front()==back()
+            samples.resize(2*m);
+            for(size_t j=0; j<m; j++) { // Each vertex once
+                const Point& p=line[j==0? m-1: j-1];
+                const Point& q=line[j+1];
+                pt_t tx=q.x-p.x, ty=q.y-p.y, l=std::sqrt(tx*tx+ty*ty);
+                if(l>0) { tx *= dist/l; ty *= dist/l; }
+                samples[2*j]   = Point(line[j].x-ty, line[j].y+tx);
+                samples[2*j+1] = Point(line[j].x+ty, line[j].y-tx);
+            }
+            values.resize(2*m);
+            bilinear(im,w,h, &samples[0], 2*m, &values[0]);
+            double sum=0;
+            for(size_t j=0; j<m; j++)
+                sum += std::abs(values[2*j]-values[2*j+1]);
+            contrast[i] = sum/m;
+        }
+    }
+}
+
+#endif
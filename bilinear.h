@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file bilinear.h
+ * @brief Evaluation of the bilinear interpolation of an image
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef BILINEAR_H
+#define BILINEAR_H
+
+#include "lltree.h"
+
+template <typename T>
+float bilinear(const T* im, size_t w, size_t h, const Point& p);
+
+template <typename T>
+void bilinear(const T* im, size_t w, size_t h,
+              const Point* p, size_t n, float* out);
+
+template <typename T>
+void mean_contrast(LLTree& tree, const T* im, size_t w, size_t h,
+                   std::vector<double>& contrast, pt_t dist=0.5f);
+
+// Templates must have their implementation nearby
+#include "bilinear.cpp"
+
+#endif
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file border.cpp
+ * @brief Constant border of image, as required by level line extraction
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "border.h"
+
+/// Compute histogram of level at pixels at the border of the image.
+static void histogram(unsigned char* im, size_t w, size_t h, size_t histo[256]){
+    size_t j;
+    for(j=0; j<w; j++) // First line
+        ++histo[im[j]];
+    for(size_t i=1; i+1<h; i++) { // All lines except first and last
+        ++histo[im[j]];  // First pixel of line
+        j+= w-1;
+        ++histo[im[j++]]; // Last pixel of line
+    }
+    for(; j<w*h; j++) // Last line
+        ++histo[im[j]];    
+}
+
+/// Put pixels at border of image to value \a v.
+static void put_border(unsigned char* im, size_t w, size_t h, unsigned char v) {
+    size_t j;
+    for(j=0; j<w; j++)
+        im[j] = v;
+    for(size_t i=1; i+1<h; i++) {
+        im[j] = v;
+        j+= w-1;
+        im[j++] = v;
+    }
+    for(; j<w*h; j++)
+        im[j] = v;
+}
+
+/// Set all pixels at border of image to their median level.
+unsigned char fill_border(unsigned char* im, size_t w, size_t h) {
+    size_t histo[256] = {0}; // This puts all values to zero
+    histogram(im, w, h, histo);
+    size_t limit=w+h-2; // Half number of pixels at border
+    size_t sum=0;
+    int i=-1;
+    while((sum+=histo[++i]) < limit);
+    put_border(im,w,h, (unsigned char)i);
+    return (unsigned char)i;
+}
@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file border.h
+ * @brief Constant border of image, as required by level line extraction
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef BORDER_H
+#define BORDER_H
+
+#include <cstddef>
+
+unsigned char fill_border(unsigned char* im, size_t w, size_t h);
+
+#endif
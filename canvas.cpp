@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file canvas.cpp
+ * @brief Images to draw into, dense or as spans of constant value
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifdef CANVAS_H
+
+#include <algorithm>
+
+/// Fill pixels x0<=x<x1 of row y with value \a v.
+template <typename T>
+void DenseCanvas<T>::fill(int y, int x0, int x1, T v) {
+    std::fill(im_+y*w_+x0, im_+y*w_+x1, v);
+}
+
+/// Constructor: all pixels have value \a background.
+template <typename T>
+SpanCanvas<T>::SpanCanvas(int w, int h, T background)
+: w_(w), bg_(background), rows_(h) {}
+
+/// First span of row \a r starting after abscissa \a x.
+template <typename T>
+typename SpanCanvas<T>::iterator SpanCanvas<T>::after(std::vector<Span>& r,
+                                                      int x) {
+    iterator b=r.begin(), e=r.end();
+    if(b!=e && (e-1)->x<=x) // Drawing from left to right is frequent
+        return e;
+    return std::lower_bound(b, e, x+1);
+}
+
+/// Set pixel (x,y) to value \a v. The row is modified only if the value of
+/// the pixel changes.
+template <typename T>
+void SpanCanvas<T>::set(int x, int y, T v) {
+    std::vector<Span>& r = rows_[y];
+    iterator it = after(r, x);
+    if((it==r.begin()? bg_: (it-1)->v) != v)
+        fill(y, x, x+1, v);
+}
+
+/// Fill pixels x0<=x<x1 of row y with value \a v.
+/// Consecutive spans of a row have different values, the first one differs
+/// from the background. The spans starting in [x0,x1] are replaced by at most
+/// two, the one of \a v and the one resuming at x1.
+template <typename T>
+void SpanCanvas<T>::fill(int y, int x0, int x1, T v) {
+    if(x0 >= x1)
+        return;
+    std::vector<Span>& r = rows_[y];
+    iterator e = after(r, x1);
+    T vAfter = (e==r.begin())? bg_: (e-1)->v; // Value at x1
+    iterator b = std::lower_bound(r.begin(), e, x0);
+    T vBefore = (b==r.begin())? bg_: (b-1)->v; // Value at x0-1
+    Span s[2];
+    int n=0;
+    if(vBefore != v) {
+        s[n].x = x0;
+        s[n++].v = v;
+    }
+    if(vAfter != v && x1 < w_) {
+        s[n].x = x1;
+        s[n++].v = vAfter;
+    }
+    int k = std::min(n, (int)(e-b)); // Spans overwritten in place
+    std::copy(s, s+k, b);
+    if(k < n)
+        r.insert(b+k, s+k, s+n);
+    else
+        r.erase(b+k, e);
+}
+
+/// Rasterize row \a y in \a out, an array of width() pixels.
+template <typename T>
+void SpanCanvas<T>::row(int y, T* out) const {
+    const std::vector<Span>& r = rows_[y];
+    typename std::vector<Span>::const_iterator it=r.begin();
+    int x=0;
+    T v=bg_;
+    for(; it!=r.end(); ++it) {
+        std::fill(out+x, out+it->x, v);
+        x = it->x;
+        v = it->v;
+    }
+    std::fill(out+x, out+w_, v);
+}
+
+/// Number of stored spans.
+template <typename T>
+size_t SpanCanvas<T>::spans() const {
+    size_t n=0;
+    for(size_t i=0; i<rows_.size(); i++)
+        n += rows_[i].size();
+    return n;
+}
+
+#endif
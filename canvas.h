@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file canvas.h
+ * @brief Images to draw into, dense or as spans of constant value
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <vector>
+
+/// Canvas as an array of pixels.
+template <typename T>
+class DenseCanvas {
+public:
+    DenseCanvas(T* im, int w, int h): im_(im), w_(w), h_(h) {}
+    int width() const { return w_; }
+    int height() const { return h_; }
+    void set(int x, int y, T v) { im_[y*w_+x] = v; }
+    void fill(int y, int x0, int x1, T v);
+private:
+    T* im_;
+    int w_, h_;
+};
+
+/// Canvas storing each row as a list of spans of constant value. Only spans
+/// different from the background are stored, so that memory depends on drawn
+/// content and not on area.
+template <typename T>
+class SpanCanvas {
+public:
+    SpanCanvas(int w, int h, T background);
+    int width() const { return w_; }
+    int height() const { return (int)rows_.size(); }
+    void set(int x, int y, T v);
+    void fill(int y, int x0, int x1, T v);
+    void row(int y, T* out) const;
+    size_t spans() const;
+private:
+    /// Span starting at x, until the start of the next one.
+    struct Span {
+        int x;
+        T v;
+        bool operator<(int x2) const { return x<x2; }
+    };
+    typedef typename std::vector<Span>::iterator iterator;
+    int w_;
+    T bg_;
+    std::vector< std::vector<Span> > rows_; ///< Spans of a row, sorted by x
+    static iterator after(std::vector<Span>& r, int x);
+};
+
+// Templates must have their implementation nearby
+#include "canvas.cpp"
+
+#endif
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file coverage.cpp
+ * @brief Anti-aliased rasterization by exact area coverage
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "coverage.h"
+#include <algorithm>
+#include <cmath>
+
+/// Number of pixels in a chunk of row. Must be a power of 2.
+static const int CHUNK = 32;
+static const int LOG_CHUNK = 5;
+
+/// Constructor.
+/// \param w the number of columns.
+/// \param rows the number of rows of a band.
+Coverage::Coverage(int w, int rows)
+: w_(w), rows_(rows), y0_(0), acc_((w+2)*rows, 0.0f),
+  chunks_(((w+2)>>LOG_CHUNK)+1), dirty_(chunks_*rows, false),
+  xmin_(w), xmax_(-1), ymin_(rows), ymax_(-1) {}
+
+/// Start a band at row \a y0. Accumulation must be empty (see blend).
+void Coverage::start(int y0) {
+    y0_ = y0;
+}
+
+/// Accumulate signed area at the right of edge pq, clipped to the band.
+void Coverage::edge(Point p, Point q) {
+    if(p.y == q.y)
+        return;
+    float dir = 1;
+    if(p.y > q.y) {
+        std::swap(p,q);
+        dir = -1;
+    }
+    const float ya=std::max(p.y,(pt_t)y0_), yb=std::min(q.y,(pt_t)(y0_+rows_));
+    if(ya >= yb)
+        return;
+    const float dxdy = (q.x-p.x)/(q.y-p.y);
+    float x = p.x + (ya-p.y)*dxdy;
+    for(int y=(int)std::floor(ya); (float)y<yb; y++) {
+        float dy = std::min((float)(y+1),yb) - std::max((float)y,ya);
+        float xnext = x + dxdy*dy;
+        float d = dy*dir;
+        float* a = &acc_[(y-y0_)*(w_+2)];
+        float x0=std::min(x,xnext), x1=std::max(x,xnext);
+        x0 = std::max(0.0f, std::min((float)w_, x0));
+        x1 = std::max(0.0f, std::min((float)w_, x1));
+        float x0floor = std::floor(x0), x1ceil = std::ceil(x1);
+        int x0i=(int)x0floor, x1i=(int)x1ceil;
+        xmin_ = std::min(xmin_, x0i);
+        xmax_ = std::max(xmax_, x1i);
+        ymin_ = std::min(ymin_, y-y0_);
+        ymax_ = std::max(ymax_, y-y0_);
+        std::vector<bool>::iterator dirty = dirty_.begin()+(y-y0_)*chunks_;
+        for(int k=x0i>>LOG_CHUNK; k<=(x1i+1)>>LOG_CHUNK; k++)
+            dirty[k] = true;
+        if(x1i <= x0i+1) { // Inside a single pixel
+            float xmf = 0.5f*(x0+x1) - x0floor;
+            a[x0i]   += d - d*xmf;
+            a[x0i+1] += d*xmf;
+        } else { // Spanning several pixels
+            float s = 1/(x1-x0);
+            float x0f = x0-x0floor;
+            float a0 = 0.5f*s*(1-x0f)*(1-x0f);
+            float x1f = x1-x1ceil+1;
+            float am = 0.5f*s*x1f*x1f;
+            a[x0i] += d*a0;
+            if(x1i == x0i+2)
+                a[x0i+1] += d*(1-a0-am);
+            else {
+                float a1 = s*(1.5f-x0f);
+                a[x0i+1] += d*(a1-a0);
+                for(int xi=x0i+2; xi<x1i-1; xi++)
+                    a[xi] += d*s;
+                float a2 = a1 + (x1i-x0i-3)*s;
+                a[x1i-1] += d*(1-a2-am);
+            }
+            a[x1i] += d*am;
+        }
+        x = xnext;
+    }
+}
+
+/// Accumulate edges of index first<=i<last of a closed polygon, the edge
+/// of index i joining points i and i+1. Points are transformed by \a t then
+/// shifted by half a pixel, so that integer coordinates are pixel centers, as
+/// in fill_curve. A polygon can be accumulated piecewise, for example only the
+/// edges crossing the current band.
+void Coverage::fill(const std::vector<Point>& pts, const TransformPoint& t,
+                    size_t first, size_t last) {
+    const Point half(.5f,.5f);
+    Point o = t(pts[first])+half;
+    for(size_t i=first+1; i<=last; i++) {
+        Point p = t(pts[i])+half;
+        edge(o, p);
+        o = p;
+    }
+}
+
+/// Accumulate segments of index first<=i<last of a polyline as quads of
+/// given \a width. All quads have the same orientation, so that they add up
+/// where they overlap. Points are transformed and shifted as in fill().
+void Coverage::stroke(const std::vector<Point>& pts, const TransformPoint& t,
+                      size_t first, size_t last, pt_t width) {
+    const Point half(.5f,.5f);
+    Point b = t(pts[first])+half;
+    for(size_t i=first+1; i<=last; i++) {
+        Point a=b;
+        b = t(pts[i])+half;
+        pt_t dx=b.x-a.x, dy=b.y-a.y, l=std::sqrt(dx*dx+dy*dy);
+        if(l == 0)
+            continue;
+        Point n(-dy*width/(2*l), dx*width/(2*l));
+        Point q[4] = {a+n, b+n, Point(b.x-n.x,b.y-n.y), Point(a.x-n.x,a.y-n.y)};
+        for(int k=0; k<4; k++)
+            edge(q[k], q[(k+1)%4]);
+    }
+}
+
+/// Blend \a color into \a rgb (band of rows, 3 floats per pixel) with the
+/// accumulated coverage, and clear the accumulation buffer.
+void Coverage::blend(const unsigned char color[3], float* rgb) {
+    for(int y=ymin_; y<=ymax_; y++) {
+        float* a = &acc_[y*(w_+2)];
+        std::vector<bool>::iterator dirty = dirty_.begin()+y*chunks_;
+        float sum = 0;
+        for(int k=xmin_>>LOG_CHUNK; k<=(xmax_+1)>>LOG_CHUNK; k++) {
+            if(! dirty[k] && std::abs(sum) < 1e-6f)
+                continue; // Out of polygon, nothing to blend
+            dirty[k] = false;
+            int x=k*CHUNK, xend=std::min(x+CHUNK, w_+2);
+            float* out = rgb + 3*(y*(size_t)w_+x);
+            for(; x<xend; x++, out+=3) {
+                sum += a[x];
+                a[x] = 0;
+                if(x >= w_)
+                    continue;
+                float c = std::min(1.0f, std::abs(sum));
+                if(c > 0)
+                    for(int i=0; i<3; i++)
+                        out[i] += c*(color[i]-out[i]);
+            }
+        }
+    }
+    xmin_ = w_; xmax_ = -1;
+    ymin_ = rows_; ymax_ = -1;
+}
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file coverage.h
+ * @brief Anti-aliased rasterization by exact area coverage
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include "levelLine.h"
+
+/// Accumulation buffer of signed area covered by polygons, for a band of
+/// rows. The prefix sum along a row of the accumulated values is the area of
+/// each pixel inside the polygon. Pixel (x,y) is the square [x,x+1]x[y,y+1].
+/// Modified chunks of rows are recorded, so that blending skips the parts of
+/// rows out of the polygons, which is most of the bounding box for strokes.
+class Coverage {
+public:
+    Coverage(int w, int rows);
+    int band() const { return rows_; }
+    void start(int y0);
+    void fill(const std::vector<Point>& pts, const TransformPoint& t,
+              size_t first, size_t last);
+    void stroke(const std::vector<Point>& pts, const TransformPoint& t,
+                size_t first, size_t last, pt_t width=1);
+    void blend(const unsigned char color[3], float* rgb);
+private:
+    int w_, rows_, y0_;
+    std::vector<float> acc_; ///< rows_ lines of w_+2 values
+    int chunks_; ///< Number of chunks per row
+    std::vector<bool> dirty_; ///< Modified chunks of each row
+    int xmin_, xmax_, ymin_, ymax_; ///< Modified area of acc_
+    void edge(Point p, Point q);
+};
+
+#endif
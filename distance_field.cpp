@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file distance_field.cpp
+ * @brief Signed distance field to level lines, rendered at any zoom
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "distance_field.h"
+#include "fill_curve.h"
+#include "bilinear.h"
+#include <algorithm>
+#include <cmath>
+
+/// Squared distance standing for infinity, finite to keep arithmetic exact.
+static const float FAR = 1e20f;
+
+/// Half-width of the band around lines where distances are computed exactly:
+/// it includes the corners of all interpolation cells met by the lines.
+static const int BAND = 1;
+
+/// Canvas toggling the parity of pixels inside curves. Rows are stored as
+/// difference arrays of w+1 entries: pixel x is inside an odd number of curves
+/// if the XOR of entries 0 to x of its row is 1.
+class ParityCanvas {
+public:
+    ParityCanvas(unsigned char* diff, int w, int h)
+    : d_(diff), w_(w), h_(h) {}
+    int width() const { return w_; }
+    int height() const { return h_; }
+    void set(int x, int y, unsigned char) { fill(y, x, x+1, 1); }
+    void fill(int y, int x0, int x1, unsigned char) {
+        d_[y*(w_+1)+x0] ^= 1;
+        d_[y*(w_+1)+x1] ^= 1;
+    }
+private:
+    unsigned char* d_;
+    int w_, h_;
+};
+
+/// Set in \a f the squared distance to segment [\a a,\a b] of pixels at
+/// most BAND away from its bounding box, if lower than their current value,
+/// and in \a near the nearest point of the segment.
+static void seed_segment(const Point& a, const Point& b,
+                         float* f, Point* near, int w, int h) {
+    const int x0 = std::max(0,   (int)std::floor(std::min(a.x,b.x))-BAND);
+    const int x1 = std::min(w-1, (int)std::ceil (std::max(a.x,b.x))+BAND);
+    const int y0 = std::max(0,   (int)std::floor(std::min(a.y,b.y))-BAND);
+    const int y1 = std::min(h-1, (int)std::ceil (std::max(a.y,b.y))+BAND);
+    const float ux=b.x-a.x, uy=b.y-a.y, n=ux*ux+uy*uy;
+    const float ix=(n>0)? ux/n: 0, iy=(n>0)? uy/n: 0;
+    for(int y=y0; y<=y1; y++) {
+        const float vy = y-a.y;
+        const size_t i = (size_t)y*w;
+        for(int x=x0; x<=x1; x++) {
+            const float vx = x-a.x;
+            float s = std::max(0.0f, std::min(1.0f, ix*vx+iy*vy));
+            const float dx=vx-s*ux, dy=vy-s*uy, d=dx*dx+dy*dy;
+            if(d < f[i+x]) {
+                f[i+x] = d;
+                near[i+x] = Point(a.x+s*ux, a.y+s*uy);
+            }
+        }
+    }
+}
+
+/// Squared distance transform of the 1D function \a f of \a n samples, as the
+/// lower envelope of parabolas rooted at samples (Felzenszwalb-Huttenlocher).
+/// \a v and \a z are buffers of n and n+1 elements. The result replaces f,
+/// and \a arg gets the sample of the minimum at each position.
+static void edt(float* f, int n, int* v, float* z, int* arg) {
+    int k=0;
+    v[0] = 0;
+    z[0] = -FAR;
+    z[1] = +FAR;
+    for(int q=1; q<n; q++) {
+        float s;
+        while(true) { // Terminates at k=0, since |s|<FAR/2
+            const int p=v[k];
+            s = ((f[q]+(float)q*q)-(f[p]+(float)p*p))/(2.0f*(q-p));
+            if(s > z[k])
+                break;
+            --k;
+        }
+        v[++k] = q;
+        z[k] = s;
+        z[k+1] = +FAR;
+    }
+    k = 0;
+    for(int q=0; q<n; q++) {
+        while(z[k+1] < (float)q)
+            ++k;
+        arg[q] = v[k];
+    }
+    for(int q=0; q<n; q++) {
+        const float dq = (float)(q-arg[q]);
+        z[q] = f[arg[q]] + dq*dq;
+    }
+    std::copy(z, z+n, f);
+}
+
+/// Distance transform of image \a f of size \a w x \a h, holding squared
+/// distances to lines in a band around them, FAR elsewhere, and \a near the
+/// nearest points of lines in the band. The exact Euclidean distance transform
+/// of the band (1D transforms of columns, then of rows) gives at each pixel
+/// the band pixel b minimizing f(b)+|p-b|^2. The distance to the nearest
+/// point of b replaces f, so that it is exact in the band.
+static void edt(float* f, const Point* near, int w, int h) {
+    std::vector<int> row((size_t)w*h); // Row of minimum of column transform
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        const int n = std::max(w,h);
+        std::vector<int> v(n), arg(n);
+        std::vector<float> z(n+1), col(n);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for(int x=0; x<w; x++) {
+            for(int y=0; y<h; y++)
+                col[y] = f[(size_t)y*w+x];
+            edt(&col[0], h, &v[0], &z[0], &arg[0]);
+            for(int y=0; y<h; y++) {
+                f[(size_t)y*w+x] = col[y];
+                row[(size_t)y*w+x] = arg[y];
+            }
+        }
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for(int y=0; y<h; y++) {
+            float* r = f+(size_t)y*w;
+            edt(r, w, &v[0], &z[0], &arg[0]);
+            for(int x=0; x<w; x++) {
+                if(r[x] >= FAR) { // No line
+                    r[x] = std::sqrt(FAR);
+                    continue;
+                }
+                const Point& p = near[(size_t)row[(size_t)y*w+arg[x]]*w+arg[x]];
+                r[x] = std::sqrt((p.x-x)*(p.x-x) + (p.y-y)*(p.y-y));
+            }
+        }
+    }
+}
+
+/// Signed distance field to closed level lines.
+/// \param lines the selected level lines.
+/// \param w,h the dimensions of the field.
+/// \param t the transform from image to field coordinates.
+/// \param[out] d the field, array of w x h distances in field samples.
+/// The distance is negative inside an odd number of lines, with the rules of
+/// fill_curve. It is exact in a band of BAND samples around the lines, and
+/// beyond it, the distance to a nearby point of the lines found by an exact
+/// Euclidean distance transform of the band.
+void distance_field(const std::vector<const LevelLine*>& lines,
+                    int w, int h, const TransformPoint& t, float* d) {
+    std::fill(d, d+(size_t)w*h, FAR);
+    std::vector<Point> near((size_t)w*h);
+    std::vector<unsigned char> parity((size_t)(w+1)*h, 0);
+    ParityCanvas canvas(&parity[0], w, h);
+    std::vector< std::vector<pt_t> > inter(h);
+    std::vector<const LevelLine*>::const_iterator it=lines.begin();
+    for(; it!=lines.end(); ++it) {
+        const std::vector<Point>& line = (*it)->line;
+        if(line.empty())
+            continue;
+        Point a = t(line.back());
+        pt_t y0=a.y, y1=a.y;
+        for(std::vector<Point>::const_iterator p=line.begin();
+            p!=line.end(); ++p) {
+            Point b = t(*p);
+            seed_segment(a, b, d, &near[0], w, h);
+            y0 = std::min(y0, b.y);
+            y1 = std::max(y1, b.y);
+            a = b;
+        }
+        // Same rules as fill_curve, rows of intersections being reused
+        PolyIterator poly(line, t);
+        if(poly.dir==0) {
+            fill_point(poly.p, (unsigned char)1, canvas);
+            continue;
+        }
+        for(std::vector<Point>::const_iterator p=line.begin()+1;
+            p!=line.end(); ++p)
+            poly.add_point(t(*p), inter);
+        poly.add_point(t(line.front()), inter);
+        int iy0=std::max(0,(int)std::floor(y0)), iy1=std::min(h-1,(int)y1);
+        for(int y=iy0; y<=iy1; y++)
+            if(! inter[y].empty()) {
+                fill_line((unsigned char)1, canvas, y, inter[y]);
+                inter[y].clear();
+            }
+    }
+
+    edt(d, &near[0], w, h);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for(int y=0; y<h; y++) {
+        const unsigned char* p = &parity[(size_t)y*(w+1)];
+        float* r = d+(size_t)y*w;
+        unsigned char in=0;
+        for(int x=0; x<w; x++) {
+            in ^= p[x];
+            if(in)
+                r[x] = -r[x];
+        }
+    }
+}
+
+/// 8-bit code of signed distance \a d, clamped.
+unsigned char encode_distance(float d) {
+    float v = std::floor(FIELD_ZERO - FIELD_STEPS*d + 0.5f);
+    return (unsigned char)std::max(0.0f, std::min(255.0f, v));
+}
+
+/// Render level lines from their encoded distance field, by thresholding its
+/// bilinear interpolation.
+/// \param field,w,h the encoded field, of size at least 2x2.
+/// \param z the zoom factor from field samples to output pixels.
+/// \param width the width of lines in output pixels.
+/// \param inside whether pixels inside lines are distinguished.
+/// \param[out] out the image of size w*z x h*z, values of FieldPixel.
+/// The cost is independent of the number of level lines.
+void render_field(const unsigned char* field, size_t w, size_t h,
+                  int z, float width, bool inside, unsigned char* out) {
+    const size_t W=w*z, H=h*z;
+    const float line = 0.5f*FIELD_STEPS*width/z; // In codes
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<Point> p(W);
+        std::vector<float> v(W);
+        for(size_t x=0; x<W; x++)
+            p[x].x = x/(pt_t)z;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for(int y=0; y<(int)H; y++) {
+            for(size_t x=0; x<W; x++)
+                p[x].y = y/(pt_t)z;
+            bilinear(field, w, h, &p[0], W, &v[0]);
+            unsigned char* o = out+y*W;
+            for(size_t x=0; x<W; x++) {
+                float c = v[x]-FIELD_ZERO;
+                o[x] = (std::abs(c)<=line)? FIELD_LINE:
+                    (inside && c>0)? FIELD_INSIDE: FIELD_OUTSIDE;
+            }
+        }
+    }
+}
@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file distance_field.h
+ * @brief Signed distance field to level lines, rendered at any zoom
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include "levelLine.h"
+#include <cstddef>
+
+void distance_field(const std::vector<const LevelLine*>& lines,
+                    int w, int h, const TransformPoint& t, float* d);
+
+/// Code of distance 0 and number of codes per sample of distance in the 8-bit
+/// encoding of a field. Codes above zero are inside.
+const int FIELD_ZERO=128, FIELD_STEPS=16;
+
+unsigned char encode_distance(float d);
+
+void render_field(const unsigned char* field, size_t w, size_t h,
+                  int z, float width, bool inside, unsigned char* out);
+
+/// Values of pixels of render_field.
+enum FieldPixel { FIELD_LINE=0, FIELD_INSIDE, FIELD_OUTSIDE };
+
+#endif
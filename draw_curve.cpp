@@ -8,22 +8,24 @@
 
 #ifdef DRAW_CURVE_H
 
-/// max(0,min(abs(v),m-1))
-static int clip(pt_t v, int m) {
-    if(v<0)
-        return 0;
-    if(v>=m)
-        return m-1;
-    return (int)v;
-}
+#include <algorithm>
+#include <cmath>
 
-/// Draw line in image
-template <typename T>
-void draw_line(const Point& p, const Point& q, T v, T* im, int w, int h) {
-    int x0=clip(p.x,w), x1=clip(q.x,w);
-    int y0=clip(p.y,h), y1=clip(q.y,h);
+/// Draw line in image. Pixels outside the canvas are skipped, so that a
+/// canvas showing part of the image (a tile) gets the same pixels as the full
+/// image.
+template <typename T, class Canvas>
+void draw_line(const Point& p, const Point& q, T v, Canvas& c) {
+    const int w=c.width(), h=c.height();
+    int x0=(int)std::floor(p.x), x1=(int)std::floor(q.x);
+    int y0=(int)std::floor(p.y), y1=(int)std::floor(q.y);
+    if(std::max(x0,x1)<0 || std::min(x0,x1)>=w ||
+       std::max(y0,y1)<0 || std::min(y0,y1)>=h)
+        return; // Segment outside canvas
+    const bool inside = (0<=std::min(x0,x1) && std::max(x0,x1)<w &&
+                         0<=std::min(y0,y1) && std::max(y0,y1)<h);
     if(x0==x1 && y0==y1) {
-        im[y0*w+x0] = v;
+        c.set(x0, y0, v);
         return;
     }
     int sx = (x0<x1)? +1: -1;
@@ -34,7 +36,8 @@ void draw_line(const Point& p, const Point& q, T v, T* im, int w, int h) {
     if(adx>=ady) {
         int z=-adx/2;
         while(x!=dx) {
-            im[(y+y0)*w+(x+x0)] = v;
+            if(inside || (0<=x+x0 && x+x0<w && 0<=y+y0 && y+y0<h))
+                c.set(x+x0, y+y0, v);
             x += sx;
             z += ady;
             if(z>0) {
@@ -45,7 +48,8 @@ void draw_line(const Point& p, const Point& q, T v, T* im, int w, int h) {
     } else {
         int z=-ady/2;
         while(y!=dy) {
-            im[(y+y0)*w+(x+x0)] = v;
+            if(inside || (0<=x+x0 && x+x0<w && 0<=y+y0 && y+y0<h))
+                c.set(x+x0, y+y0, v);
             y += sy;
             z += adx;
             if(z>0) {
@@ -56,9 +60,9 @@ void draw_line(const Point& p, const Point& q, T v, T* im, int w, int h) {
     }
 }
 
-/// Draw curve in image
-template <typename T>
-void draw_curve(const std::vector<Point>& curve, T v, T* im, int w, int h,
+/// Draw curve in canvas
+template <typename T, class Canvas>
+void draw_curve(const std::vector<Point>& curve, T v, Canvas& c,
                 const TransformPoint& t) {
     if(curve.empty())
         return;
@@ -66,9 +70,17 @@ void draw_curve(const std::vector<Point>& curve, T v, T* im, int w, int h,
     std::vector<Point>::const_iterator it=curve.begin();
     Point o = *it++;
     while(it != curve.end()) {
-        draw_line(t(o)+delta, t(*it)+delta, v, im,w,h);
+        draw_line(t(o)+delta, t(*it)+delta, v, c);
         o = *it++;
     }
 }
 
+/// Draw curve in image
+template <typename T>
+void draw_curve(const std::vector<Point>& curve, T v, T* im, int w, int h,
+                const TransformPoint& t) {
+    DenseCanvas<T> c(im, w, h);
+    draw_curve(curve, v, c, t);
+}
+
 #endif
@@ -10,10 +10,14 @@
 #define DRAW_CURVE_H
 
 #include "levelLine.h"
+#include "canvas.h"
 
 template <typename T>
 void draw_curve(const std::vector<Point>& curve, T v, T* im, int w, int h,
                 const TransformPoint& t=TransformPoint());
+template <typename T, class Canvas>
+void draw_curve(const std::vector<Point>& curve, T v, Canvas& c,
+                const TransformPoint& t=TransformPoint());
 
 #include "draw_curve.cpp"
 
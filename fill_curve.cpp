@@ -9,6 +9,7 @@
 #ifdef FILL_CURVE_H
 
 #include <algorithm>
+#include <cmath>
 #include <cassert>
 
 /// Sign of f2-f1
@@ -38,11 +39,12 @@ struct PolyIterator {
     bool bHorizontal; ///< Along horizontal edgel?
     signed char dir; ///< right(+1)/left(-1) if horizontal, else down(+1)/up(-1)
     PolyIterator(const std::vector<Point>& curve, const TransformPoint& t);
-    void add_point(const Point& pi, std::vector< std::vector<pt_t> >& inter);
+    template <class Bounds>
+    void add_point(const Point& pi, Bounds& inter);
 };
 
 /// Constructor
-PolyIterator::PolyIterator(const std::vector<Point>& curve,
+inline PolyIterator::PolyIterator(const std::vector<Point>& curve,
                            const TransformPoint& t)
 : p(t(curve[0])), bHorizontal(false), dir(0) {
     size_t i = last_point(curve);
@@ -57,14 +59,15 @@ PolyIterator::PolyIterator(const std::vector<Point>& curve,
 }
 
 /// Add bound of interval on line iy at position x
-static void bound(std::vector< std::vector<pt_t> >& inter, pt_t x, int iy) {
+inline void bound(std::vector< std::vector<pt_t> >& inter, pt_t x, int iy) {
     if(0<=iy && iy<(int)inter.size())
         inter[iy].push_back(x);
 }
 
 /// Add segment to point i to current polyline: see [2]Figure 4 for the rules.
-void PolyIterator::add_point(const Point& pi,
-                             std::vector< std::vector<pt_t> >& inter) {
+/// Bounds of intervals are given to \a inter through function bound.
+template <class Bounds>
+inline void PolyIterator::add_point(const Point& pi, Bounds& inter) {
     Point q = p;
     p = pi;
     signed char dirP = dir; // Previous direction
@@ -113,66 +116,124 @@ void PolyIterator::add_point(const Point& pi,
 }
 
 /// Fill curve with a single vertex
-template <class T>
-void fill_point(Point p, T value, T* out, size_t w) {
-    if(is_integer(p.x) && is_integer(p.y))
-        out[(int)p.y*w+(int)p.x] = value;
+template <typename T, class Canvas>
+void fill_point(Point p, T value, Canvas& c) {
+    if(is_integer(p.x) && is_integer(p.y) &&
+       0<=p.x && (int)p.x<c.width() && 0<=p.y && (int)p.y<c.height())
+        c.set((int)p.x, (int)p.y, value);
 }
 
-/// Fill line of image
-template <typename T>
-void fill_line(T value, T* im, T* end, std::vector<pt_t>& inter) {
+/// Fill line \a y of image. Pixels between two successive intersections
+/// (sorted), or at an intersection, are inside.
+template <typename T, class Canvas>
+void fill_line(T value, Canvas& c, int y, std::vector<pt_t>& inter) {
     std::sort(inter.begin(), inter.end());
-    bool bIn = false; // inside/outside
+    assert(inter.size()%2 == 0);
+    const int w=c.width();
     std::vector<pt_t>::const_iterator it=inter.begin();
-    for(;it!=inter.end() && *it<0; ++it) // Handle curve outside left boundary
-        bIn = !bIn;
-    if(it==inter.end()) return;
-    if(bIn)
-        std::fill(im, std::min(end,im+(int)*it), value);
-    pt_t i = (pt_t)(int)*it; // Current pixel number (int stored as pt_t)
-    im += (int)i;
-    for(; im<end; i++, im++) {
-        while(*it<i) {
-            bIn = !bIn;
-            if(++it == inter.end()) {
-                assert(!bIn);
-                return;
-            }
-        }
-        if(bIn || *it==i)
-            *im = value;
+    for(; it!=inter.end(); it+=2) {
+        pt_t a=std::ceil(it[0]), b=std::floor(it[1]);
+        if(b<0)
+            continue;
+        if(a>=(pt_t)w)
+            break;
+        int x0=std::max(0,(int)a), x1=std::min(w-1,(int)b);
+        c.fill(y, x0, x1+1, value);
     }
 }
 
 /// Fill in intervals defined by inter
-template <typename T>
-void fill_inter(T value, T* im, size_t w, size_t h,
-                std::vector< std::vector<pt_t> >& inter) {
-    for(size_t i=0; i<h; i++)
+template <typename T, class Canvas>
+void fill_inter(T value, Canvas& c, std::vector< std::vector<pt_t> >& inter) {
+    for(int i=0; i<c.height(); i++)
         if(! inter[i].empty())
-            fill_line(value, im+i*w, im+(i+1)*w, inter[i]);
+            fill_line(value, c, i, inter[i]);
 }
 
 /// Fill interior region of curve.
-template <typename T>
+template <typename T, class Canvas>
 void fill_curve(const std::vector<Point>& line, T value,
-                T* out, int w, int h, const TransformPoint& t) {
+                Canvas& c, const TransformPoint& t) {
     if(line.empty())
         return;
     PolyIterator p(line,t);
     if(p.dir==0) { // Single vertex
-        fill_point(p.p, value, out,w);
+        fill_point(p.p, value, c);
         return;
     }
 
-    std::vector< std::vector<pt_t> > inter(h);
+    std::vector< std::vector<pt_t> > inter(c.height());
     std::vector<Point>::const_iterator it=line.begin()+1;
     for(; it!=line.end(); ++it)
         p.add_point(t(*it), inter);
     p.add_point(t(line.front()), inter); // Close polygon
 
-    fill_inter(value, out, w, h, inter);
+    fill_inter(value, c, inter);
+}
+
+/// Constructor.
+/// \param inter intersections of each row, sorted, from level line extraction.
+/// \param nodes the level lines, indexed as in \a inter.
+inline
+LineCrossings::LineCrossings(const std::vector< std::vector<Inter> >& inter,
+                             const std::vector<LLTree::Node>& nodes)
+: first_(nodes.size()+1, 0), rounded_(nodes.size(), false) {
+    const size_t n=nodes.size();
+    std::vector< std::vector<Inter> >::const_iterator it;
+    std::vector<Inter>::const_iterator it2;
+    for(it=inter.begin(); it!=inter.end(); ++it)
+        for(it2=it->begin(); it2!=it->end(); ++it2)
+            ++first_[it2->second+1];
+    for(size_t i=0; i<n; i++)
+        first_[i+1] += first_[i];
+    cross_.resize(first_[n]);
+    std::vector<size_t> next(first_.begin(), first_.end()-1);
+    for(it=inter.begin(); it!=inter.end(); ++it)
+        for(it2=it->begin(); it2!=it->end(); ++it2) {
+            Crossing& c = cross_[next[it2->second]++];
+            c.y = (int)(it-inter.begin());
+            c.x = it2->first;
+        }
+    for(size_t i=0; i<n; i++) {
+        const std::vector<Point>& line = nodes[i].ll->line;
+        std::vector<Point>::const_iterator p=line.begin();
+        for(; p!=line.end(); ++p)
+            if(is_integer(p->x) && is_integer(p->y)) {
+                rounded_[i] = true;
+                break;
+            }
+    }
+}
+
+/// Fill interior of level line \a i, of polyline \a line. Crossings of the
+/// line with a row come in pairs delimiting an interval inside.
+/// A crossing of a vertical edgel very close to a data point may be rounded
+/// to it in the polyline (beyond row 256 in float), then the rules of
+/// fill_curve differ: it is used for such a line, so that both agree exactly.
+template <typename T, class Canvas>
+void LineCrossings::fill(size_t i, const std::vector<Point>& line, T v,
+                         Canvas& c) const {
+    if(rounded_[i]) {
+        fill_curve(line, v, c);
+        return;
+    }
+    const int w=c.width();
+    for(size_t k=first_[i]; k<first_[i+1]; k+=2) {
+        const Crossing &a=cross_[k], &b=cross_[k+1];
+        assert(a.y == b.y);
+        int x0=std::max(0,(int)std::ceil(a.x));
+        int x1=std::min(w-1,(int)std::floor(b.x));
+        if(x0 <= x1)
+            c.fill(a.y, x0, x1+1, v);
+    }
+}
+
+/// Fill interior region of curve in image.
+template <typename T>
+void fill_curve(const std::vector<Point>& line, T value,
+                T* out, int w, int h, const TransformPoint& t) {
+    DenseCanvas<T> c(out, w, h);
+    fill_curve(line, value, c, t);
 }
 
 #endif
@@ -9,11 +9,34 @@
 #ifndef FILL_CURVE_H
 #define FILL_CURVE_H
 
-#include "levelLine.h"
+#include "lltree.h"
+#include "canvas.h"
 
 template <typename T>
 void fill_curve(const std::vector<Point>& line, T v, T* im, int w, int h,
                 const TransformPoint& t=TransformPoint());
+template <typename T, class Canvas>
+void fill_curve(const std::vector<Point>& line, T v, Canvas& c,
+                const TransformPoint& t=TransformPoint());
+
+/// Intersections of level lines with data rows, as recorded by extraction,
+/// grouped by level line. They allow filling at zoom 1 without scanning the
+/// polyline, except for lines with a vertex rounded to a data point.
+class LineCrossings {
+public:
+    LineCrossings(const std::vector< std::vector<Inter> >& inter,
+                  const std::vector<LLTree::Node>& nodes);
+    template <typename T, class Canvas>
+    void fill(size_t i, const std::vector<Point>& line, T v, Canvas& c) const;
+private:
+    struct Crossing {
+        int y;
+        pt_t x;
+    };
+    std::vector<size_t> first_; ///< Index of first crossing of each line
+    std::vector<bool> rounded_; ///< Line has a vertex at a data point
+    std::vector<Crossing> cross_; ///< Sorted by row, then abscissa
+};
 
 // Templates must have their implementation nearby
 #include "fill_curve.cpp"
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file ingest.cpp
+ * @brief Read an image ready for level line extraction
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "ingest.h"
+#include "singular.h"
+#include "border.h"
+#include "io_png.h"
+#include <cstdlib>
+
+/// Singular points, found as rows of the image are decoded.
+struct RowScan {
+    const size_t &w, &h; ///< Known before the first row
+    Singular* sing;
+    RowScan(const size_t& w0, const size_t& h0): w(w0), h(h0), sing(0) {}
+};
+
+/// Add decoded row \a y to the singular points of \a ctx, a RowScan.
+static void scan_row(size_t y, unsigned char* row, void* ctx) {
+    RowScan& scan = *static_cast<RowScan*>(ctx);
+    if(y == 0)
+        scan.sing = new Singular(scan.w, scan.h);
+    scan.sing->add_row(row);
+}
+
+/// Read PNG image as gray levels and set its border to constant.
+/// \param fname the PNG file name.
+/// \param[out] w,h dimensions of the image.
+/// \param[out] sing (optional) singular points of the image, found while
+/// rows are decoded instead of in a later pass over the image; null if the
+/// image is empty. To be deleted by the caller.
+/// \return the image, to be freed by the caller, or null if reading fails.
+unsigned char* ingest(const char* fname, size_t& w, size_t& h,
+                      Singular** sing) {
+    RowScan scan(w, h);
+    unsigned char* im = io_png_read_u8_gray_rows(fname, &w, &h,
+                                                 sing? scan_row: 0, &scan);
+    if(! im) {
+        delete scan.sing;
+        return 0;
+    }
+    fill_border(im, w, h);
+    if(sing) {
+        if(scan.sing)
+            scan.sing->complete(im);
+        *sing = scan.sing;
+    }
+    return im;
+}
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file ingest.h
+ * @brief Read an image ready for level line extraction
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <cstddef>
+struct Singular;
+
+unsigned char* ingest(const char* fname, size_t& w, size_t& h,
+                      Singular** sing=0);
+
+#endif
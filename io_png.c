@@ -338,6 +338,44 @@ unsigned char *io_png_read_u8_rgb(const char *fname, size_t * nxp,
     }
 }
 
+/**
+ * @brief RGB->gray conversion of one 8bit pixel
+ *
+ * Y = (6968 * R + 23434 * G + 2366 * B) / 32768
+ * integer approximation of
+ * Y = Cr* R + Cg * G + Cb * B
+ * with
+ * Cr = 0.212639005871510
+ * Cg = 0.715168678767756
+ * Cb = 0.072192315360734
+ * derived from ITU BT.709-5 (Rec 709) sRGB and D65 definitions
+ * http://www.itu.int/rec/R-REC-BT.709/en
+ *
+ * @param p interleaved R, G, B values
+ * @return gray value
+ */
+static unsigned char _io_png_gray(const unsigned char *p)
+{
+    /*
+     * if int type is less than 24 bits, we use long ints,
+     * guaranteed to be >=32 bit
+     */
+#if (UINT_MAX>>24 == 0)
+#define CR 6968ul
+#define CG 23434ul
+#define CB 2366ul
+#else
+#define CR 6968u
+#define CG 23434u
+#define CB 2366u
+#endif
+    /* (1 << 14) is added for rounding instead of truncation */
+    return (unsigned char) ((CR*p[0] + CG*p[1] + CB*p[2] + (1 << 14)) >> 15);
+#undef CR
+#undef CG
+#undef CB
+}
+
 /**
  * @brief read a PNG file into a 8bit integer array, converted to gray
  *
@@ -364,46 +402,135 @@ unsigned char *io_png_read_u8_gray(const char *fname,
         size_t i, size;
         unsigned char *p, *q;
 
-        /*
-         * RGB->gray conversion
-         * Y = (6968 * R + 23434 * G + 2366 * B) / 32768
-         * integer approximation of
-         * Y = Cr* R + Cg * G + Cb * B
-         * with
-         * Cr = 0.212639005871510
-         * Cg = 0.715168678767756
-         * Cb = 0.072192315360734
-         * derived from ITU BT.709-5 (Rec 709) sRGB and D65 definitions
-         * http://www.itu.int/rec/R-REC-BT.709/en
-         */
         size = *nxp * *nyp;
         p = q = img;
         for (i = 0; i < size; i++, p+=3)
-            /*
-             * if int type is less than 24 bits, we use long ints,
-             * guaranteed to be >=32 bit
-             */
-#if (UINT_MAX>>24 == 0)
-#define CR 6968ul
-#define CG 23434ul
-#define CB 2366ul
-#else
-#define CR 6968u
-#define CG 23434u
-#define CB 2366u
-#endif
-            /* (1 << 14) is added for rounding instead of truncation */
-            *q++ = (unsigned char) ((CR*p[0] + CG*p[1] + CB*p[2] +
-                                     (1 << 14)) >> 15);
-#undef CR
-#undef CG
-#undef CB
+            *q++ = _io_png_gray(p);
         /* resize and return the image */
         img = (unsigned char *) realloc(img, size * sizeof(unsigned char));
         return img;
     }
 }
 
+/**
+ * @brief read a PNG file into a 8bit integer array, converted to gray,
+ * each row being given to a callback as soon as it is decoded
+ *
+ * The result is the same as io_png_read_u8_gray(). For a non-interlaced
+ * file, row y is given to the callback before row y+1 is decoded, so
+ * that the rows can be processed while the file is read. The rows stay
+ * in place in the returned array, so previous rows can still be read by
+ * the callback, but not modified. An interlaced file is decoded as a
+ * whole before its rows are given in order.
+ *
+ * @param fname PNG file name, "-" means stdin
+ * @param nxp, nyp pointers to variables to be filled with the number of
+ *        columns and lines of the image, before the first row is given
+ * @param row function receiving row y (nx bytes), ignored if NULL
+ * @param ctx user data passed to row
+ * @return pointer to an allocated unsigned char array of pixels,
+ *         or NULL if an error happens
+ */
+unsigned char *io_png_read_u8_gray_rows(const char *fname,
+                                        size_t * nxp, size_t * nyp,
+                                        io_png_row_fn row, void *ctx)
+{
+    png_byte png_sig[PNG_SIG_LEN];
+    png_structp png_ptr;
+    png_infop info_ptr;
+    png_bytep src;
+    unsigned char *dst;
+    /* volatile: because of setjmp/longjmp */
+    FILE *volatile fp = NULL;
+    unsigned char *volatile img = NULL;
+    png_byte *volatile buf = NULL;
+    size_t nx, ny, nc, i, j;
+    int passes, k;
+    /* local error structure */
+    _io_png_err_t err;
+
+    /* parameters check */
+    if (NULL == fname || NULL == nxp || NULL == nyp)
+        return NULL;
+
+    /* open the PNG input file */
+    if (0 == strcmp(fname, "-"))
+        fp = stdin;
+    else if (NULL == (fp = fopen(fname, "rb")))
+        return NULL;
+
+    /* read in some of the signature bytes and check this signature */
+    if ((PNG_SIG_LEN != fread(png_sig, 1, PNG_SIG_LEN, fp))
+        || 0 != png_sig_cmp(png_sig, (png_size_t) 0, PNG_SIG_LEN))
+        return _io_png_read_abort(fp, NULL, NULL);
+
+    if (NULL == (png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING,
+                                                  &err, &_io_png_err_hdl,
+                                                  NULL)))
+        return _io_png_read_abort(fp, NULL, NULL);
+    if (NULL == (info_ptr = png_create_info_struct(png_ptr)))
+        return _io_png_read_abort(fp, &png_ptr, NULL);
+
+    /* handle read errors */
+    if (setjmp(err.jmpbuf)) {
+        free(img);
+        free(buf);
+        return _io_png_read_abort(fp, &png_ptr, &info_ptr);
+    }
+
+    png_init_io(png_ptr, fp);
+    png_set_sig_bytes(png_ptr, PNG_SIG_LEN);
+    png_read_info(png_ptr, info_ptr);
+
+    /* same transforms as io_png_read_u8_gray(): 8bit gray or RGB */
+    png_set_strip_16(png_ptr);
+    png_set_packing(png_ptr);
+    png_set_strip_alpha(png_ptr);
+    png_set_palette_to_rgb(png_ptr);
+    passes = png_set_interlace_handling(png_ptr);
+    png_read_update_info(png_ptr, info_ptr);
+
+    nx = (size_t) png_get_image_width(png_ptr, info_ptr);
+    ny = (size_t) png_get_image_height(png_ptr, info_ptr);
+    nc = (size_t) png_get_channels(png_ptr, info_ptr);
+    if (1 != nc && 3 != nc)
+        png_error(png_ptr, "unexpected number of channels");
+    *nxp = nx;
+    *nyp = ny;
+    if (NULL == (img = (unsigned char *) malloc(nx * ny)))
+        png_error(png_ptr, "out of memory");
+
+    if (1 < passes) {
+        /* every pass contributes to every row: decode all */
+        if (1 == nc)
+            buf = NULL;
+        else if (NULL == (buf = (png_byte *) malloc(nx * ny * nc)))
+            png_error(png_ptr, "out of memory");
+        for (k = 0; k < passes; k++)
+            for (j = 0; j < ny; j++)
+                png_read_row(png_ptr, (buf ? buf : img) + j * nx * nc, NULL);
+    } else if (1 < nc
+               && NULL == (buf = (png_byte *) malloc(nx * nc)))
+        png_error(png_ptr, "out of memory");
+
+    for (j = 0; j < ny; j++) {
+        dst = img + j * nx;
+        src = (1 == nc) ? dst : (1 < passes) ? buf + j * nx * nc : buf;
+        if (1 == passes)
+            png_read_row(png_ptr, src, NULL);
+        if (1 != nc)
+            for (i = 0; i < nx; i++)
+                dst[i] = _io_png_gray(src + 3 * i);
+        if (NULL != row)
+            row(j, dst, ctx);
+    }
+    png_read_end(png_ptr, info_ptr);
+
+    free(buf);
+    (void) _io_png_read_abort(fp, &png_ptr, &info_ptr);
+    return img;
+}
+
 /**
  * @brief read a PNG file into a 32bit float array
  *
@@ -722,6 +849,187 @@ int io_png_write_f32(const char *fname, const float *data,
                             IO_PNG_F32);
 }
 
+/**
+ * @brief internal function used to write a non-interlaced 8bit PNG
+ * file row by row
+ *
+ * @param fname PNG file name, "-" means stdout
+ * @param nx, ny number of columns and lines of the image
+ * @param nc number of channels, 0 for palette indices
+ * @param pal, npal palette, ignored if nc>0
+ * @param row function filling row y, nx*max(nc,1) bytes
+ * @param ctx user data passed to row
+ * @return 0 if everything OK, -1 if an error occured
+ */
+static int io_png_write_rows(const char *fname, size_t nx, size_t ny,
+                             size_t nc, const png_color *pal, size_t npal,
+                             io_png_row_fn row, void *ctx)
+{
+    png_structp png_ptr;
+    png_infop info_ptr;
+    png_byte *idata = NULL;
+    int bit_depth, color_type;
+    /* volatile: because of setjmp/longjmp */
+    FILE *volatile fp;
+    size_t i;
+    /* error structure */
+    _io_png_err_t err;
+
+    if (4 < nc)
+        return -1;
+
+    /* open the PNG output file */
+    if (0 == strcmp(fname, "-"))
+        fp = stdout;
+    else if (NULL == (fp = fopen(fname, "wb")))
+        return -1;
+
+    if (NULL == (idata = (png_byte *) malloc(nx * (nc ? nc : 1))))
+        return _io_png_write_abort(fp, NULL, NULL, NULL, NULL);
+    if (NULL == (png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+                                                   &err, &_io_png_err_hdl,
+                                                   NULL)))
+        return _io_png_write_abort(fp, idata, NULL, NULL, NULL);
+    if (NULL == (info_ptr = png_create_info_struct(png_ptr)))
+        return _io_png_write_abort(fp, idata, NULL, &png_ptr, NULL);
+    if (0 != setjmp(err.jmpbuf))
+        return _io_png_write_abort(fp, idata, NULL, &png_ptr, &info_ptr);
+
+    bit_depth = 8;
+    switch (nc) {
+    case 0:
+        color_type = PNG_COLOR_TYPE_PALETTE;
+        bit_depth = (npal <= 2) ? 1 : (npal <= 4) ? 2 : (npal <= 16) ? 4 : 8;
+        break;
+    case 1:
+        color_type = PNG_COLOR_TYPE_GRAY;
+        break;
+    case 2:
+        color_type = PNG_COLOR_TYPE_GRAY_ALPHA;
+        break;
+    case 3:
+        color_type = PNG_COLOR_TYPE_RGB;
+        break;
+    case 4:
+        color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+        break;
+    }
+
+    png_init_io(png_ptr, fp);
+    png_set_IHDR(png_ptr, info_ptr, (png_uint_32) nx, (png_uint_32) ny,
+                 bit_depth, color_type, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+    if (0 == nc)
+        png_set_PLTE(png_ptr, info_ptr, pal, (int) npal);
+    png_write_info(png_ptr, info_ptr);
+    if (bit_depth < 8)
+        png_set_packing(png_ptr);
+
+    for (i = 0; i < ny; i++) {
+        row(i, idata, ctx);
+        png_write_row(png_ptr, idata);
+    }
+    png_write_end(png_ptr, info_ptr);
+
+    (void) _io_png_write_abort(fp, idata, NULL, &png_ptr, &info_ptr);
+    return 0;
+}
+
+/**
+ * @brief write a 8bit PNG file, rows given by a callback
+ *
+ * The PNG file is written non-interlaced. Rows are requested in
+ * order, so the image never needs to be stored as a whole.
+ *
+ * @param fname PNG file name, "-" means stdout
+ * @param nx, ny, nc number of columns, lines and channels of the image
+ * @param row function filling row y (nx*nc bytes, channels interleaved)
+ * @param ctx user data passed to row
+ * @return 0 if everything OK, -1 if an error occured
+ */
+int io_png_write_u8_rows(const char *fname, size_t nx, size_t ny, size_t nc,
+                         io_png_row_fn row, void *ctx)
+{
+    if (0 >= nx || 0 >= ny || 0 >= nc)
+        return -1;
+    if (NULL == fname || NULL == row)
+        return -1;
+    return io_png_write_rows(fname, nx, ny, nc, NULL, 0, row, ctx);
+}
+
+/**
+ * @brief write a paletted PNG file, rows of indices given by a callback
+ *
+ * The PNG file is written non-interlaced, with the smallest bit depth
+ * (1, 2, 4 or 8) able to store the indices; rows keep one byte per
+ * pixel and are packed on the fly. Rows are requested in order, so the
+ * image never needs to be stored as a whole.
+ *
+ * @param fname PNG file name, "-" means stdout
+ * @param nx, ny number of columns and lines of the image
+ * @param palette array of ncolors RGB triplets
+ * @param ncolors number of colors of the palette, at most 256
+ * @param row function filling row y (nx indices, each less than ncolors)
+ * @param ctx user data passed to row
+ * @return 0 if everything OK, -1 if an error occured
+ */
+int io_png_write_u8_palette_rows(const char *fname, size_t nx, size_t ny,
+                                 const unsigned char *palette, size_t ncolors,
+                                 io_png_row_fn row, void *ctx)
+{
+    png_color pal[256];
+    size_t i;
+
+    /* parameters check */
+    if (0 >= nx || 0 >= ny || 0 >= ncolors || 256 < ncolors)
+        return -1;
+    if (NULL == fname || NULL == palette || NULL == row)
+        return -1;
+    for (i = 0; i < ncolors; i++) {
+        pal[i].red = palette[3 * i];
+        pal[i].green = palette[3 * i + 1];
+        pal[i].blue = palette[3 * i + 2];
+    }
+    return io_png_write_rows(fname, nx, ny, 0, pal, ncolors, row, ctx);
+}
+
+/* row callback copying from an array */
+typedef struct _io_png_array_s {
+    const unsigned char *data;
+    size_t nx;
+} _io_png_array_t;
+
+static void _io_png_array_row(size_t y, unsigned char *row, void *ctx)
+{
+    const _io_png_array_t *a = (const _io_png_array_t *) ctx;
+    memcpy(row, a->data + y * a->nx, a->nx);
+}
+
+/**
+ * @brief write an array of palette indices into a paletted PNG file
+ *
+ * See io_png_write_u8_palette_rows().
+ *
+ * @param fname PNG file name, "-" means stdout
+ * @param data array of indices, each less than ncolors
+ * @param nx, ny number of columns and lines of the image
+ * @param palette array of ncolors RGB triplets
+ * @param ncolors number of colors of the palette, at most 256
+ * @return 0 if everything OK, -1 if an error occured
+ */
+int io_png_write_u8_palette(const char *fname, const unsigned char *data,
+                            size_t nx, size_t ny,
+                            const unsigned char *palette, size_t ncolors)
+{
+    _io_png_array_t a;
+    if (NULL == data)
+        return -1;
+    a.data = data;
+    a.nx = nx;
+    return io_png_write_u8_palette_rows(fname, nx, ny, palette, ncolors,
+                                        &_io_png_array_row, &a);
+}
+
 /**
  * @brief RGB->gray conversion
  *
@@ -29,17 +29,23 @@ extern "C" {
 
 #include <stddef.h>
 
+/* fill (write) or receive (read) row y of an image, ctx is user data */
+typedef void (*io_png_row_fn)(size_t y, unsigned char *row, void *ctx);
 
 /* io_png.c */
 char *io_png_info(void);
 unsigned char *io_png_read_u8(const char *fname, size_t *nxp, size_t *nyp, size_t *ncp);
 unsigned char *io_png_read_u8_rgb(const char *fname, size_t *nxp, size_t *nyp);
 unsigned char *io_png_read_u8_gray(const char *fname, size_t *nxp, size_t *nyp);
+unsigned char *io_png_read_u8_gray_rows(const char *fname, size_t *nxp, size_t *nyp, io_png_row_fn row, void *ctx);
 float *io_png_read_f32(const char *fname, size_t *nxp, size_t *nyp, size_t *ncp);
 float *io_png_read_f32_rgb(const char *fname, size_t *nxp, size_t *nyp);
 float *io_png_read_f32_gray(const char *fname, size_t *nxp, size_t *nyp);
 int io_png_write_u8(const char *fname, const unsigned char *data, size_t nx, size_t ny, size_t nc);
 int io_png_write_f32(const char *fname, const float *data, size_t nx, size_t ny, size_t nc);
+int io_png_write_u8_rows(const char *fname, size_t nx, size_t ny, size_t nc, io_png_row_fn row, void *ctx);
+int io_png_write_u8_palette(const char *fname, const unsigned char *data, size_t nx, size_t ny, const unsigned char *palette, size_t ncolors);
+int io_png_write_u8_palette_rows(const char *fname, size_t nx, size_t ny, const unsigned char *palette, size_t ncolors, io_png_row_fn row, void *ctx);
 
 float rgb_to_gray(float r, float g, float b);
 
@@ -0,0 +1,496 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file label_map.cpp
+ * @brief Innermost level line at each pixel, statistics and masks of regions
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "label_map.h"
+#include "tree_reduce.h"
+#include "fill_curve.h"
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+/// Interval [x0,x1] of pixels of row y inside a level line.
+struct Interval {
+    int y, x0, x1;
+    unsigned int node; ///< Index of the level line
+    unsigned int rank; ///< Pre-order rank of node: descendants come after
+};
+
+/// Order of intervals of a row.
+static bool less_x0(const Interval& i1, const Interval& i2) {
+    return (i1.x0 < i2.x0);
+}
+
+/// Sort intervals [b,e) of a row of width \a w by x0: comparison sort if they
+/// are few, counting sort otherwise. \a count and \a tmp are buffers.
+static void sort_row(std::vector<Interval>::iterator b,
+                     std::vector<Interval>::iterator e, int w,
+                     std::vector<size_t>& count, std::vector<Interval>& tmp) {
+    const size_t n = e-b;
+    if(n*8 < (size_t)w) {
+        std::sort(b, e, less_x0);
+        return;
+    }
+    count.assign(w+1, 0);
+    for(std::vector<Interval>::iterator it=b; it!=e; ++it)
+        ++count[it->x0+1];
+    for(int x=0; x<w; x++)
+        count[x+1] += count[x];
+    tmp.resize(n);
+    for(std::vector<Interval>::iterator it=b; it!=e; ++it)
+        tmp[count[it->x0]++] = *it;
+    std::copy(tmp.begin(), tmp.end(), b);
+}
+
+/// Interval still open at current abscissa during the sweep of a row.
+/// The one of highest rank is the innermost.
+static bool less_rank(const Interval& i1, const Interval& i2) {
+    return (i1.rank < i2.rank);
+}
+
+/// Bounds of intervals of a line in rows [0,h), as pairs (row, abscissa).
+struct RowBounds {
+    int h;
+    int ymin, ymax; ///< Range of rows of bounds
+    std::vector< std::pair<int,pt_t> > b;
+    std::vector< std::pair<int,pt_t> > sorted; ///< By row, then abscissa
+    std::vector<size_t> start; ///< Buffer for counting sort
+    void sort();
+};
+
+/// Add bound \a x of interval of row \a iy, called by PolyIterator.
+static void bound(RowBounds& r, pt_t x, int iy) {
+    if(0<=iy && iy<r.h) {
+        r.b.push_back(std::make_pair(iy,x));
+        r.ymin = std::min(r.ymin, iy);
+        r.ymax = std::max(r.ymax, iy);
+    }
+}
+
+/// Counting sort of bounds by row, then sort of each row by abscissa.
+void RowBounds::sort() {
+    start.assign(ymax-ymin+2, 0);
+    for(size_t k=0; k<b.size(); k++)
+        ++start[b[k].first-ymin+1];
+    for(size_t y=0; y+1<start.size(); y++)
+        start[y+1] += start[y];
+    sorted.resize(b.size());
+    for(size_t k=0; k<b.size(); k++)
+        sorted[start[b[k].first-ymin]++] = b[k];
+    for(size_t k=0; k<sorted.size();) {
+        size_t e = k;
+        while(e<sorted.size() && sorted[e].first==sorted[k].first)
+            ++e;
+        if(e-k > 2)
+            std::sort(sorted.begin()+k, sorted.begin()+e);
+        else if(e-k==2 && sorted[k+1].second < sorted[k].second)
+            std::swap(sorted[k], sorted[k+1]);
+        k = e;
+    }
+}
+
+/// Append to \a out the intervals of pixels inside \a line, following the
+/// rules of fill_curve. \a rb is a buffer.
+static void intervals(const std::vector<Point>& line, int w, int h,
+                      Interval I, RowBounds& rb, std::vector<Interval>& out) {
+    if(line.empty())
+        return;
+    PolyIterator p(line, TransformPoint());
+    if(p.dir==0) { // Single vertex
+        if(is_integer(p.p.x) && is_integer(p.p.y) &&
+           0<=p.p.x && (int)p.p.x<w && 0<=p.p.y && (int)p.p.y<h) {
+            I.y = (int)p.p.y;
+            I.x0 = I.x1 = (int)p.p.x;
+            out.push_back(I);
+        }
+        return;
+    }
+    rb.h = h;
+    rb.ymin = h;
+    rb.ymax = -1;
+    rb.b.clear();
+    std::vector<Point>::const_iterator it=line.begin()+1;
+    for(; it!=line.end(); ++it)
+        p.add_point(*it, rb);
+    p.add_point(line.front(), rb); // Close polygon
+    if(rb.b.empty())
+        return;
+    rb.sort();
+    const std::vector< std::pair<int,pt_t> >& B = rb.sorted;
+    assert(B.size()%2 == 0);
+    for(size_t k=0; k+1<B.size(); k+=2) {
+        assert(B[k].first == B[k+1].first);
+        pt_t a=std::ceil(B[k].second), b=std::floor(B[k+1].second);
+        if(b<0 || a>=(pt_t)w)
+            continue;
+        I.y = B[k].first;
+        I.x0 = std::max(0,(int)a);
+        I.x1 = std::min(w-1,(int)b);
+        if(I.x0 <= I.x1)
+            out.push_back(I);
+    }
+}
+
+/// Runs of innermost nodes of a row, from its intervals sorted by x0. Between
+/// successive bounds, the innermost open interval gives the node. Adjacent
+/// runs of the same node are joined.
+static void sweep_row(std::vector<Interval>::const_iterator it,
+                      std::vector<Interval>::const_iterator end,
+                      std::vector<Interval>& open,
+                      std::vector<Interval>& runs) {
+    open.clear();
+    runs.clear();
+    int x=0;
+    while(it!=end || !open.empty()) {
+        if(open.empty())
+            x = std::max(x, it->x0);
+        for(; it!=end && it->x0<=x; ++it) {
+            open.push_back(*it);
+            std::push_heap(open.begin(), open.end(), less_rank);
+        }
+        while(!open.empty() && open.front().x1<x) {
+            std::pop_heap(open.begin(), open.end(), less_rank);
+            open.pop_back();
+        }
+        if(open.empty())
+            continue;
+        int x1 = open.front().x1;
+        if(it != end)
+            x1 = std::min(x1, it->x0-1);
+        if(!runs.empty() && runs.back().node==open.front().node &&
+           runs.back().x1+1==x)
+            runs.back().x1 = x1;
+        else {
+            runs.push_back(open.front());
+            runs.back().x0 = x;
+            runs.back().x1 = x1;
+        }
+        x = x1+1;
+    }
+}
+
+/// Sweep the rows of the image, calling \a out(y,runs) with the runs of
+/// innermost nodes of row y, in parallel over rows.
+/// \param[out] rank the pre-order rank of each node of \c tree.nodes().
+/// The intervals of lines along rows are computed in parallel over lines,
+/// gathered by row with a counting sort, then each row is swept.
+template <class RowOut>
+static void sweep(LLTree& tree, size_t w, size_t h,
+                  std::vector<unsigned int>& rank, RowOut& out) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const int n = (int)nodes.size();
+    rank.resize(n);
+    if(n==0 || w==0 || h==0)
+        return;
+    unsigned int r=0;
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it)
+        rank[&*it-&nodes[0]] = r++;
+
+    // Intervals of all lines, then counting sort by row
+    std::vector<Interval> all;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<Interval> mine;
+        RowBounds rb;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64) nowait
+#endif
+        for(int i=0; i<n; i++) {
+            Interval I = {0, 0, 0, (unsigned int)i, rank[i]};
+            intervals(nodes[i].ll->line, (int)w, (int)h, I, rb, mine);
+        }
+#ifdef _OPENMP
+#pragma omp critical(label_map)
+#endif
+        all.insert(all.end(), mine.begin(), mine.end());
+    }
+    std::vector<size_t> start(h+1, 0);
+    for(size_t k=0; k<all.size(); k++)
+        ++start[all[k].y+1];
+    for(size_t y=0; y<h; y++)
+        start[y+1] += start[y];
+    std::vector<Interval> rows(all.size());
+    std::vector<size_t> pos(start.begin(), start.end()-1);
+    for(size_t k=0; k<all.size(); k++)
+        rows[pos[all[k].y]++] = all[k];
+    std::vector<Interval>().swap(all);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<Interval> open, tmp, runs;
+        std::vector<size_t> count;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,16)
+#endif
+        for(int y=0; y<(int)h; y++) {
+            std::vector<Interval>::iterator b=rows.begin()+start[y],
+                e=rows.begin()+start[y+1];
+            sort_row(b, e, (int)w, count, tmp);
+            sweep_row(b, e, open, runs);
+            out(y, runs);
+        }
+    }
+}
+
+/// Write runs of a row in the label map.
+struct LabelRow {
+    unsigned int* label;
+    size_t w;
+    void operator()(int y, const std::vector<Interval>& runs) const {
+        unsigned int* row = label + y*w;
+        std::vector<Interval>::const_iterator it=runs.begin();
+        for(; it!=runs.end(); ++it)
+            std::fill(row+it->x0, row+it->x1+1, it->node+1);
+    }
+};
+
+/// Innermost node containing each pixel, in a single sweep of the rows.
+/// \param tree the tree of level lines.
+/// \param w,h the dimensions of the image.
+/// \param[out] label index in \c tree.nodes() plus one, 0 if no line contains
+/// the pixel.
+/// The pixels inside a line are the ones filled by fill_curve, and the result
+/// is the same as filling all lines in pre-order. The intervals of lines along
+/// rows are computed in parallel over lines, then each row is swept in
+/// parallel: the cost is proportional to the number of pixels and intervals,
+/// not to the sum of areas of lines.
+void label_map(LLTree& tree, size_t w, size_t h,
+               std::vector<unsigned int>& label) {
+    label.assign(w*h, 0);
+    std::vector<unsigned int> rank;
+    LabelRow out = {label.empty()? 0: &label[0], w};
+    sweep(tree, w, h, rank, out);
+}
+
+/// Keep runs of each row, to be distributed to nodes afterwards.
+struct KeepRow {
+    std::vector< std::vector<Interval> >& rows;
+    KeepRow(std::vector< std::vector<Interval> >& r): rows(r) {}
+    void operator()(int y, const std::vector<Interval>& runs) const {
+        rows[y] = runs;
+    }
+};
+
+/// Count of nodes in subtree.
+struct CountInit {
+    size_t operator()(const LLTree::Node&) const { return 1; }
+};
+struct CountMerge {
+    void operator()(size_t& n, size_t c) const { n += c; }
+};
+
+/// Number of pixels of a mask.
+size_t area(const RunMask& m) {
+    size_t a=0;
+    for(RunMask::const_iterator it=m.begin(); it!=m.end(); ++it)
+        a += it->x1 - it->x0;
+    return a;
+}
+
+/// Order of runs, by row then abscissa.
+static bool less_run(const Run& r1, const Run& r2) {
+    return (r1.y<r2.y || (r1.y==r2.y && r1.x0<r2.x0));
+}
+
+/// Intersection of masks \a m1 and \a m2, in linear time.
+void intersect(const RunMask& m1, const RunMask& m2, RunMask& out) {
+    out.clear();
+    RunMask::const_iterator i=m1.begin(), j=m2.begin();
+    while(i!=m1.end() && j!=m2.end()) {
+        if(i->y != j->y) {
+            if(i->y < j->y) ++i; else ++j;
+            continue;
+        }
+        Run r = {i->y, std::max(i->x0,j->x0), std::min(i->x1,j->x1)};
+        if(r.x0 < r.x1)
+            out.push_back(r);
+        if(i->x1 < j->x1) ++i; else ++j;
+    }
+}
+
+/// Build masks of all nodes of \a tree in an image of dimensions \a w x \a h.
+/// The runs are those of label_map, so that masks follow the rules of
+/// fill_curve. They are distributed to nodes by a counting sort in row order.
+RegionMasks::RegionMasks(LLTree& tree, size_t w, size_t h)
+: base_(tree.nodes().empty()? 0: &tree.nodes()[0]) {
+    std::vector< std::vector<Interval> > rows(h);
+    KeepRow out(rows);
+    sweep(tree, w, h, rank_, out);
+    const size_t n = rank_.size();
+    first_.assign(n+1, 0);
+    for(size_t y=0; y<h; y++)
+        for(size_t k=0; k<rows[y].size(); k++)
+            ++first_[rows[y][k].rank+1];
+    for(size_t r=0; r<n; r++)
+        first_[r+1] += first_[r];
+    runs_.resize(first_.back());
+    area_.assign(n+1, 0);
+    std::vector<size_t> pos(first_.begin(), first_.end()-1);
+    for(size_t y=0; y<h; y++) {
+        for(size_t k=0; k<rows[y].size(); k++) {
+            const Interval& I = rows[y][k];
+            Run r = {I.y, I.x0, I.x1+1};
+            runs_[pos[I.rank]++] = r;
+            area_[I.rank+1] += r.x1-r.x0;
+        }
+        std::vector<Interval>().swap(rows[y]);
+    }
+    for(size_t r=0; r<n; r++)
+        area_[r+1] += area_[r];
+    std::vector<size_t> size;
+    if(n > 0)
+        reduce_up(tree, size, CountInit(), CountMerge());
+    end_.resize(n);
+    for(size_t i=0; i<n; i++)
+        end_[rank_[i]] = rank_[i] + (unsigned int)size[i];
+}
+
+/// Number of pixels inside the level line of node \a n, in constant time.
+size_t RegionMasks::area(const LLTree::Node& n) const {
+    unsigned int r = rank_[&n-base_];
+    return area_[end_[r]] - area_[r];
+}
+
+/// Number of pixels of the ring of node \a n, its interior minus the ones of
+/// its children.
+size_t RegionMasks::ring_area(const LLTree::Node& n) const {
+    unsigned int r = rank_[&n-base_];
+    return area_[r+1] - area_[r];
+}
+
+/// Mask of the ring of node \a n, its interior minus the ones of its children.
+void RegionMasks::ring(const LLTree::Node& n, RunMask& m) const {
+    unsigned int r = rank_[&n-base_];
+    m.assign(runs_.begin()+first_[r], runs_.begin()+first_[r+1]);
+}
+
+/// Mask of the interior of node \a n: union of the rings of its subtree, which
+/// are disjoint and stored contiguously. Runs are sorted, then adjacent runs
+/// are joined.
+void RegionMasks::mask(const LLTree::Node& n, RunMask& m) const {
+    unsigned int r = rank_[&n-base_];
+    m.assign(runs_.begin()+first_[r], runs_.begin()+first_[end_[r]]);
+    if(end_[r] == r+1 || m.empty()) // Leaf, its ring is already sorted
+        return;
+    std::sort(m.begin(), m.end(), less_run);
+    RunMask::iterator out=m.begin(), it=m.begin();
+    for(++it; it!=m.end(); ++it)
+        if(it->y==out->y && it->x0==out->x1)
+            out->x1 = it->x1;
+        else
+            *++out = *it;
+    m.erase(++out, m.end());
+}
+
+/// Number of pixels inside node \a n and query mask \a q. Only rows of \a q
+/// are examined in the rings of the subtree.
+size_t RegionMasks::intersection_area(const LLTree::Node& n,
+                                      const RunMask& q) const {
+    unsigned int r = rank_[&n-base_];
+    size_t a=0;
+    if(q.empty())
+        return a;
+    for(size_t k=first_[r]; k<first_[end_[r]]; k++) {
+        const Run& R = runs_[k];
+        Run key = {R.y, R.x0, R.x0};
+        RunMask::const_iterator it =
+            std::upper_bound(q.begin(), q.end(), key, less_run);
+        if(it != q.begin() && (it-1)->y==R.y)
+            --it;
+        for(; it!=q.end() && it->y==R.y && it->x0<R.x1; ++it)
+            a += std::max(0, std::min(it->x1,R.x1) - std::max(it->x0,R.x0));
+    }
+    return a;
+}
+
+/// Mean of values, 0 for an empty region.
+double RegionStats::mean() const {
+    return count? (double)sum/count: 0;
+}
+
+/// Variance of values, 0 for an empty region.
+double RegionStats::variance() const {
+    if(count == 0)
+        return 0;
+    double m = mean();
+    return std::max(0.0, (double)sum2/count - m*m);
+}
+
+/// Statistics of an empty region.
+static RegionStats empty_stats() {
+    RegionStats s = {0, 0, 0, 255, 0};
+    return s;
+}
+
+/// Add statistics of \a s to \a acc.
+static void add_stats(RegionStats& acc, const RegionStats& s) {
+    acc.count += s.count;
+    acc.sum += s.sum;
+    acc.sum2 += s.sum2;
+    acc.min = std::min(acc.min, s.min);
+    acc.max = std::max(acc.max, s.max);
+}
+
+struct StatsInit {
+    const std::vector<RegionStats>& own;
+    const LLTree::Node* base;
+    StatsInit(const std::vector<RegionStats>& o, const LLTree::Node* b)
+    : own(o), base(b) {}
+    RegionStats operator()(const LLTree::Node& n) const { return own[&n-base]; }
+};
+struct StatsMerge {
+    void operator()(RegionStats& s, const RegionStats& c) const {
+        add_stats(s, c);
+    }
+};
+
+/// Statistics of a channel inside each level line.
+/// \param tree the tree of level lines.
+/// \param label the innermost node of each pixel (see label_map).
+/// \param channel the values, with the dimensions of \a label.
+/// \param[out] stats indexed as \c tree.nodes().
+/// Each pixel is accumulated once, at its innermost node, in a parallel pass
+/// over pixels. The statistics are then rolled up from children to parents.
+void region_stats(LLTree& tree, const std::vector<unsigned int>& label,
+                  const unsigned char* channel,
+                  std::vector<RegionStats>& stats) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const size_t n = nodes.size();
+    std::vector<RegionStats> own(n, empty_stats());
+    const long long size = (long long)label.size();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<RegionStats> mine(n, empty_stats());
+#ifdef _OPENMP
+#pragma omp for schedule(static) nowait
+#endif
+        for(long long i=0; i<size; i++)
+            if(label[i]) {
+                RegionStats& s = mine[label[i]-1];
+                unsigned char v = channel[i];
+                ++s.count;
+                s.sum += v;
+                s.sum2 += (unsigned long long)v*v;
+                s.min = std::min(s.min, v);
+                s.max = std::max(s.max, v);
+            }
+#ifdef _OPENMP
+#pragma omp critical(region_stats)
+#endif
+        for(size_t i=0; i<n; i++)
+            add_stats(own[i], mine[i]);
+    }
+    stats.clear();
+    if(n > 0)
+        reduce_up(tree, stats, StatsInit(own,&nodes[0]), StatsMerge());
+}
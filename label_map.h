@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file label_map.h
+ * @brief Innermost level line at each pixel, statistics and masks of regions
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef LABEL_MAP_H
+#define LABEL_MAP_H
+
+#include "lltree.h"
+
+void label_map(LLTree& tree, size_t w, size_t h,
+               std::vector<unsigned int>& label);
+
+/// Statistics of a channel over the pixels inside a level line.
+struct RegionStats {
+    size_t count; ///< Number of pixels
+    unsigned long long sum, sum2; ///< Sum of values and of their squares
+    unsigned char min, max; ///< Extreme values, meaningless if count==0
+    double mean() const;
+    double variance() const;
+};
+
+void region_stats(LLTree& tree, const std::vector<unsigned int>& label,
+                  const unsigned char* channel,
+                  std::vector<RegionStats>& stats);
+
+/// Run of pixels [x0,x1) of row y.
+struct Run {
+    int y, x0, x1;
+};
+/// Set of pixels as disjoint runs, sorted by row then abscissa.
+typedef std::vector<Run> RunMask;
+
+size_t area(const RunMask& m);
+void intersect(const RunMask& m1, const RunMask& m2, RunMask& out);
+
+/// Run-length encoded masks of the interiors of all level lines of a tree,
+/// without dense bitmaps. Only the runs of the ring of each node (its interior
+/// minus the ones of its children) are stored, in pre-order of nodes: the mask
+/// of a node is the union of the rings of its subtree, a contiguous range of
+/// runs shared with all its ancestors. The storage is the number of runs of
+/// the label map, not the sum of areas.
+class RegionMasks {
+public:
+    RegionMasks(LLTree& tree, size_t w, size_t h);
+    size_t runs() const { return runs_.size(); } ///< Number of stored runs
+    /// Pre-order rank of node \a n: its subtree has ranks [rank,subtree_end).
+    unsigned int rank(const LLTree::Node& n) const { return rank_[&n-base_]; }
+    unsigned int subtree_end(const LLTree::Node& n) const {
+        return end_[rank_[&n-base_]];
+    }
+    size_t area(const LLTree::Node& n) const;
+    size_t ring_area(const LLTree::Node& n) const;
+    void ring(const LLTree::Node& n, RunMask& m) const;
+    void mask(const LLTree::Node& n, RunMask& m) const;
+    size_t intersection_area(const LLTree::Node& n, const RunMask& q) const;
+private:
+    const LLTree::Node* base_; ///< First node of the tree
+    std::vector<unsigned int> rank_; ///< Pre-order rank of each node
+    std::vector<unsigned int> end_; ///< Rank after subtree, by rank
+    std::vector<size_t> first_; ///< Index of first run by rank, total at end
+    std::vector<size_t> area_; ///< Cumulated area of rings before each rank
+    std::vector<Run> runs_; ///< Runs of rings in pre-order of nodes
+};
+
+#endif
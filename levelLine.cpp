@@ -7,10 +7,11 @@
  */
 
 #include "levelLine.h"
-#include <stack>
+#include "singular.h"
 #include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <unordered_set>
 
 /// Quantification steps of singular levels. Safe up to width < 2^10 pixels.
 /// 23 bits for epsilon machine: -8 bits for image depth, -6 bits for width.
@@ -150,6 +151,46 @@ void Hyperbola::sample(const Point& p1, const Point& p2, int ptsPixel,
     }
 }
 
+/// Horizontal edgels traversed by level lines at current level. Marked edgels
+/// are recorded, so that clearing costs their number, not the image size.
+class Visit {
+public:
+    Visit(size_t n): mark_(n, false) {}
+    bool operator[](size_t i) const { return mark_[i]; }
+    /// Mark edgel \a i, return whether it was already marked.
+    bool test_and_set(size_t i) {
+        if(mark_[i])
+            return true;
+        mark_[i] = true;
+        touched_.push_back(i);
+        return false;
+    }
+    /// Number of marked edgels.
+    size_t marked() const { return touched_.size(); }
+    /// Marked edgel of rank \a k, in order of marking.
+    size_t touched(size_t k) const { return touched_[k]; }
+    /// Unmark all edgels.
+    void clear() {
+        for(std::vector<size_t>::const_iterator it=touched_.begin();
+            it!=touched_.end(); ++it)
+            mark_[*it] = false;
+        touched_.clear();
+    }
+private:
+    std::vector<bool> mark_;
+    std::vector<size_t> touched_; ///< Marked edgels
+};
+
+/// Horizontal edgels traversed by a single level line, in a hash set: memory
+/// and time are proportional to the length of the line, not the image size.
+class HashVisit {
+public:
+    /// Mark edgel \a i, return whether it was already marked.
+    bool test_and_set(size_t i) { return !mark_.insert(i).second; }
+private:
+    std::unordered_set<size_t> mark_;
+};
+
 /// A mobile dual pixel, square whose vertices are 4 data points.
 /// This is the main structure to extract a level line, moving from dual pixel
 /// to an adjacent one until coming back at starting point. The entry direction
@@ -162,9 +203,15 @@ class DualPixel {
 public:
     DualPixel(Point& p, pt_t l, const unsigned char* im, size_t w);
     void follow(Point& p, pt_t l, int ptsPixel, std::vector<Point>& line);
-    bool mark_visit(std::vector<bool>& visit,
+    template <class VisitSet>
+    bool mark_visit(VisitSet& visit,
                     std::vector< std::vector<Inter> >* inter, size_t idx,
                     const Point& p) const;
+    /// Have all vertices data?
+    bool valid(const NoData& m) const {
+        return m.dual((size_t)_pos.y*_w+(size_t)_pos.x);
+    }
+    size_t edgel() const;
 private:
     const unsigned char* _im; ///< The image stored as 1D array.
     const size_t _w; ///< Number of columns of image.
@@ -266,6 +313,12 @@ void DualPixel::follow(Point& p, pt_t l, int ptsPixel,
     }
 }
 
+/// Index of the horizontal edgel of entry, when coming from north or south.
+size_t DualPixel::edgel() const {
+    size_t i = (size_t)_pos.y*_w+(size_t)_pos.x;
+    return (_d==N)? i+_w: i;
+}
+
 /// Mark the edge as "visited", return \c false if already visited.
 /// \param visit stores the edgels traversed from the south at current level.
 /// \param inter (optional) rows of image traversed are marked with \a idx.
@@ -275,174 +328,205 @@ void DualPixel::follow(Point& p, pt_t l, int ptsPixel,
 /// When we go through a horizontal data row and going south, we store the
 /// visit. If the edgel was already visited at current level, we came back
 /// at starting point and must stop.
-bool DualPixel::mark_visit(std::vector<bool>& visit,
+template <class VisitSet>
+bool DualPixel::mark_visit(VisitSet& visit,
                            std::vector< std::vector<Inter> >* inter,
                            size_t idx, const Point& p) const {
     bool cont=true;
-    if(_d==S || _d==N) {
-        size_t i = (size_t)_pos.y*_w+(size_t)_pos.x;
-        if(_d==N)
-            i += _w;
-        cont = !visit[i];
-        visit[i] = true;
-    }
+    if(_d==S || _d==N)
+        cont = !visit.test_and_set(edgel());
     if(inter && cont && (_d==S||_d==N))
         (*inter)[(size_t)p.y].push_back( Inter(p.x,idx) );
     return cont;
 }
 
+/// Destination of extracted level lines.
+struct LineOutput {
+    LineSink& sink;
+    std::vector< std::vector<Inter> >* inter; ///< Rows traversed by lines
+    LevelLine buf; ///< Reusable buffer for the line being extracted
+    size_t n; ///< Index of next level line
+    const NoData* mask; ///< Pixels without data, if any
+    LineOutput(LineSink& s, std::vector< std::vector<Inter> >* i, size_t n0,
+               const NoData* m)
+    : sink(s), inter(i), buf(0), n(n0), mask(m) {}
+    void drop(const LevelLine& ll);
+};
+
+/// Remove from \a inter the crossings of level line \a ll, of index \a n,
+/// which is not sent to the sink. They are the last ones of their rows.
+void LineOutput::drop(const LevelLine& ll) {
+    if(! inter)
+        return;
+    std::vector<Point>::const_iterator it;
+    for(it=ll.line.begin(); it!=ll.line.end(); ++it) {
+        std::vector<Inter>& row = (*inter)[(size_t)it->y];
+        while(!row.empty() && row.back().second==n)
+            row.pop_back();
+    }
+}
+
 /// Extract level line passing through a given starting point. 
 /// \param data the values of pixels in a 1D array.
 /// \param w the number of pixel columns in \a data.
 /// \param visit array to store the visited explored horizontal edgels.
 /// \param ptsPixel number of points of discretization per pixel.
 /// \param p the starting point.
-/// \param[in,out] ll the level line: level already stored, find its line.
-/// \param idx a unique identifier for the level line.
-/// \param inter[out] (optional) rows of image traversed are marked with \a idx.
-/// \a inter is used to recover the tree hierarchy at the end, could be
-/// omitted if the tree is not required, in which case \a idx is unused.
+/// \param v the level of the level line.
+/// \param t the type of the level line.
+/// \param out where the level line is sent, with a unique identifier.
+/// \a out.inter is used to recover the tree hierarchy at the end, could be
+/// omitted if the tree is not required, in which case the identifier is only
+/// informative.
+/// If \a out.mask is given, a level line entering a dual pixel with a vertex
+/// without data is not closed: it is dropped and its identifier reused. Its
+/// edgels remain visited, so that another part of the same line, met from
+/// another seed, is dropped too: it reaches a visited edgel that is not its
+/// own first one.
 static void extract(const unsigned char* data, size_t w,
-                    std::vector<bool>& visit, int ptsPixel,
-                    Point p, LevelLine& ll, size_t idx,
-                    std::vector< std::vector<Inter> >* inter) {
+                    Visit& visit, int ptsPixel,
+                    Point p, pt_t v, LevelLine::Type t, LineOutput& out) {
+    LevelLine& ll = out.buf;
+    ll.level = v;
+    ll.type = t;
+    ll.line.clear();
     DualPixel dual(p, ll.level, data, w);
+    const size_t first = visit.marked();
     while(true) {
+        if(out.mask && !dual.valid(*out.mask)) {
+            out.drop(ll);
+            return;
+        }
         ll.line.push_back(p);
-        if(! dual.mark_visit(visit,inter,idx,p))
+        if(! dual.mark_visit(visit,out.inter,out.n,p)) {
+            if(out.mask && (visit.marked()==first ||
+                            visit.touched(first)!=dual.edgel())) {
+                out.drop(ll);
+                return;
+            }
             break;
+        }
         dual.follow(p,ll.level,ptsPixel,ll.line);
     }
+    out.sink(out.n++, ll);
 }
 
-/// Find regional maximum (or minimum if max=false) containing (x,y) in \a im.
-/// \a vu initially tags pixels that cannot take part, augmented then with
-/// pixels explored during the process.
-static bool find_extremum(const unsigned char* im, size_t w, size_t h,
-                          size_t x, size_t y, bool max,
-                          bool* vu, std::vector<Point>& V) {
-    unsigned char level=im[x+y*w];
-    vu[x+y*w] = true;
-    std::stack<Point> S;
-    S.push( Point((pt_t)x,(pt_t)y) );
-    bool success = true;
-    while(! S.empty()) {
-        Point p = S.top(); S.pop();
-        V.push_back(p);
-        for(int i=0; i<4; i++) {
-            Point q = p+delta[i];
-            size_t idx = (size_t)q.x+(size_t)q.y*w;
-            if(im[idx]==level) {
-                if(q.x==0 || (size_t)q.x+1==w || q.y==0 || (size_t)q.y+1==h)
-                    success = false;
-                else if(! vu[idx]) {
-                    vu[idx] = true;
-                    S.push(q);
-                }
-            } else if(max != (im[idx]<level))
-                success = false;
+/// Handle extrema \a E of the bilinear image.
+void handle_extrema(const unsigned char* im, size_t w,
+                    const Extrema& E,
+                    int ptsPixel,
+                    Visit& visit,
+                    LineOutput& out) {
+    for(size_t k=0; k<E.root.size(); k++) {
+        unsigned char level = im[E.root[k]];
+        pt_t v = (E.max[k]? level-DELTA_LEVEL: level+DELTA_LEVEL);
+        LevelLine::Type t = E.max[k]? LevelLine::MAX: LevelLine::MIN;
+        for(unsigned int j=E.first[k]; j<E.first[k+1]; j++) {
+            unsigned int i = E.seeds[j];
+            if(! visit[i])
+                extract(im,w, visit, ptsPixel,
+                        Point((pt_t)(i%w),(pt_t)(i/w)), v,t, out);
         }
+        visit.clear();
     }
-    return success;
 }
 
-/// Handle extrema of the bilinear image.
-void handle_extrema(const unsigned char* im, size_t w, size_t h,
+/// Handle saddle points \a S, sorted by level.
+void handle_saddles(const unsigned char* im, size_t w,
+                    const std::vector<Saddle>& S,
                     int ptsPixel,
-                    std::vector<LevelLine*>& ll,
-                    std::vector<bool>& visit,
-                    std::vector< std::vector<Inter> >* inter) {
-    bool* vu = new bool[w*h];
-    std::fill(vu, vu+w*h, false);
-    for(size_t y=1; y+1<h; y++) {
-        size_t idx = y*w+1;
-        for(size_t x=1; x+1<w; x++, idx++) {
-            if(vu[idx] || im[idx] == im[idx+1])
-                continue;
-            unsigned char level=im[idx];
-            bool max = (im[idx+1]<level);
-            std::vector<Point> V;
-            if(! find_extremum(im,w,h, x,y,max, vu, V))
-                continue;
-            pt_t v = (max? level-DELTA_LEVEL: level+DELTA_LEVEL);
-            for(std::vector<Point>::iterator it=V.begin();
-                it!=V.end(); ++it) {
-                size_t idx2 = (size_t)it->x+(size_t)it->y*w;
-                if(im[idx2+1] != level && !visit[idx2]) {
-                    LevelLine::Type t = max? LevelLine::MAX: LevelLine::MIN;
-                    LevelLine* line = new LevelLine(v,t);
-                    extract(im,w, visit, ptsPixel, *it, *line,ll.size(), inter);
-                    ll.push_back(line);
+                    Visit& visit,
+                    LineOutput& out) {
+    for(std::vector<Saddle>::const_iterator it=S.begin(); it!=S.end();) {
+        pt_t v = qlevel(it->value); // Handle together all at same quant. level
+        for(; it!=S.end() && qlevel(it->value)==v; ++it) {
+            for(size_t i=0; i<=1; i++)
+                if(! visit[it->x+(it->y+i)*w]) {
+                    Point p((pt_t)it->x,(pt_t)it->y+i);
+                    extract(im,w, visit, ptsPixel, p, v,LevelLine::SADDLE, out);
                 }
-            }
-            std::fill(visit.begin(), visit.end(), false);
         }
+        visit.clear();
     }
-    delete [] vu;
 }
 
-/// Structure to record all saddle points inside the image.
-struct Saddle {
-    size_t x, y; ///< Top-left corner of sample square
-    pt_t value; ///< Level of saddle
-    Saddle(size_t x0, size_t y0, pt_t v): x(x0), y(y0), value(v) {}
-};
-bool operator<(const Saddle& s1, const Saddle& s2) {
-    return s1.value < s2.value;
+/// Add all rows of image \a im to scanner \a scan, then complete it.
+template <class Scan>
+static void scan_image(Scan& scan, const unsigned char* im, size_t w, size_t h){
+    for(size_t y=0; y<h; y++)
+        scan.add_row(im+y*w);
+    scan.complete(im);
 }
 
-/// If saddle in unit square of top-left corner (x,y), return its level.
-static bool level_saddle(const unsigned char* im, size_t w, size_t h,
-                         size_t x, size_t y, pt_t& v) {
-    if(x+1>=w || y+1>=h)
-        return false;
-    size_t idx0=x+w*y;
-    unsigned char a=im[idx0], b=im[idx0+1], c=im[idx0+w], d=im[idx0+w+1];
-    unsigned char min=a, max=d;
-    if(min>max)
-        std::swap(min,max);
-    int sb = b<min? -1: b>max? 1: 0;
-    int sc = c<min? -1: c>max? 1: 0;
-    if(sb*sc <= 0)
-        return false;
-    v = (a*d-b*c)/pt_t(a+d-b-c);
-    return true;
+/// Extract all level lines and send them to \a out.
+/// If singular points \a sing are not given, they are found here: with
+/// OpenMP, saddle points are found and sorted concurrently with the handling
+/// of extrema. The lines are sent to \a out in the same order, from a single
+/// thread.
+static void extract_lines(const unsigned char* im, size_t w, size_t h,
+                          int ptsPixel, LineOutput& out,
+                          const Singular* sing) {
+    Visit visit(w*h);
+    if(out.inter) {
+        assert(out.inter->empty());
+        out.inter->resize(h);
+    }
+    if(sing) {
+        handle_extrema(im,w, sing->extrema, ptsPixel, visit, out);
+        handle_saddles(im,w, sing->saddles.S, ptsPixel, visit, out);
+        return;
+    }
+    Saddles S(w,h,out.mask);
+#ifdef _OPENMP
+#pragma omp parallel sections num_threads(2)
+#endif
+    {
+#ifdef _OPENMP
+#pragma omp section
+#endif
+        {
+            Extrema E(w,h,out.mask);
+            scan_image(E, im,w,h);
+            handle_extrema(im,w, E, ptsPixel, visit, out);
+        }
+#ifdef _OPENMP
+#pragma omp section
+#endif
+        scan_image(S, im,w,h);
+    }
+    handle_saddles(im,w, S.S, ptsPixel, visit, out);
 }
 
-/// Find all saddle points of the bilinear image.
-std::vector<Saddle> find_saddles(const unsigned char* im, size_t w, size_t h) {
-    std::vector<Saddle> S;
-    for(size_t y=0; y<h; y++)
-        for(size_t x=0; x<w; x++) {
-            pt_t v;
-            if(level_saddle(im,w,h, x,y, v))
-                S.push_back( Saddle(x,y,v) );
-        }
-    return S;
+/// Level lines extraction algorithm.
+/// \param im the values of pixels in a 1D array.
+/// \param w the number of pixel columns in \a data.
+/// \param h the number of pixel lines in \a data.
+/// \param ptsPixel number of points of discretization per pixel.
+/// \param sink receives each level line as soon as it is closed.
+/// \param inter[out] (optional) rows of image traversed by lines are marked.
+/// Level lines are not stored, the sink must copy what it needs. Their index,
+/// given to the sink, is the one used in \a inter, from which the hierarchy
+/// of level lines can be recovered later.
+/// \param sing (optional) singular points of \a im, when already found.
+/// \param mask (optional) pixels without data, where no level line passes.
+/// \a sing must then have been found with the same mask.
+void extract(const unsigned char* im, size_t w, size_t h,
+             int ptsPixel,
+             LineSink& sink,
+             std::vector< std::vector<Inter> >* inter,
+             const Singular* sing, const NoData* mask) {
+    LineOutput out(sink, inter, 0, mask);
+    extract_lines(im,w,h, ptsPixel, out, sing);
 }
 
-/// Handle saddle points.
-void handle_saddles(const unsigned char* im, size_t w, size_t h,
-                    int ptsPixel,
-                    std::vector<LevelLine*>& ll,
-                    std::vector<bool>& visit,
-                    std::vector< std::vector<Inter> >* inter) {
-    std::vector<Saddle> S = find_saddles(im,w,h);
-    std::sort(S.begin(), S.end());
-    for(std::vector<Saddle>::const_iterator it=S.begin(); it!=S.end();) {
-        pt_t v = qlevel(it->value); // Handle together all at same quant. level
-        for(; it!=S.end() && qlevel(it->value)==v; ++it) {
-            for(size_t i=0; i<=1; i++)
-                if(! visit[it->x+(it->y+i)*w]) {
-                    LevelLine* line = new LevelLine(v, LevelLine::SADDLE);
-                    Point p((pt_t)it->x,(pt_t)it->y+i);
-                    extract(im,w, visit, ptsPixel, p, *line, ll.size(), inter);
-                    ll.push_back(line);
-                }
-        }
-        std::fill(visit.begin(), visit.end(), false);
+/// Sink storing a copy of each level line.
+struct VectorSink : public LineSink {
+    std::vector<LevelLine*>& ll;
+    VectorSink(std::vector<LevelLine*>& l): ll(l) {}
+    void operator()(size_t /*id*/, const LevelLine& l) {
+        ll.push_back( new LevelLine(l) );
     }
-}
+};
 
 /// Level lines extraction algorithm.
 /// \param im the values of pixels in a 1D array.
@@ -451,15 +535,110 @@ void handle_saddles(const unsigned char* im, size_t w, size_t h,
 /// \param ptsPixel number of points of discretization per pixel.
 /// \param[out] ll storage for the extracted level lines.
 /// \param inter[out] (optional) rows of image traversed by ll are marked.
+/// \param sing (optional) singular points of \a im, when already found.
+/// \param mask (optional) pixels without data, where no level line passes.
 void extract(const unsigned char* im, size_t w, size_t h,
              int ptsPixel,
              std::vector<LevelLine*>& ll,
-             std::vector< std::vector<Inter> >* inter) {
-    std::vector<bool> visit(w*h, false);
-    if(inter) {
-        assert(inter->empty());
-        inter->resize(h);
+             std::vector< std::vector<Inter> >* inter,
+             const Singular* sing, const NoData* mask) {
+    VectorSink sink(ll);
+    LineOutput out(sink, inter, ll.size(), mask);
+    extract_lines(im,w,h, ptsPixel, out, sing);
+}
+
+/// Does horizontal edgel from pixel \a i to its right neighbor cross level
+/// \a l?
+inline bool crossed(const unsigned char* im, size_t i, pt_t l) {
+    return ((im[i]<l && l<im[i+1]) || (im[i+1]<l && l<im[i]));
+}
+
+/// Compute attributes of closed polyline \a line.
+static void line_attributes(const std::vector<Point>& line,
+                            LineAttributes& attr) {
+    attr.area = attr.perimeter = 0;
+    attr.min = attr.max = line.front();
+    for(size_t i=0; i+1<line.size(); i++) {
+        const Point &p=line[i], &q=line[i+1];
+        attr.area += (double)p.x*q.y - (double)q.x*p.y;
+        attr.perimeter += std::hypot((double)(q.x-p.x), (double)(q.y-p.y));
+        attr.min.x = std::min(attr.min.x, q.x);
+        attr.min.y = std::min(attr.min.y, q.y);
+        attr.max.x = std::max(attr.max.x, q.x);
+        attr.max.y = std::max(attr.max.y, q.y);
     }
-    handle_extrema(im,w,h, ptsPixel, ll, visit, inter);
-    handle_saddles(im,w,h, ptsPixel, ll, visit, inter);
+    attr.area = std::abs(attr.area)/2;
+}
+
+/// Trace the level line at level \a l through the horizontal edgel of row
+/// round(\a y) crossed by it that is nearest to abscissa \a x.
+/// Only this line is tracked, so the cost is proportional to its length and
+/// to the distance from \a x to the edgel, without any pass over the image.
+/// \param im the values of pixels in a 1D array.
+/// \param w,h the dimensions of the image.
+/// \param ptsPixel number of points of discretization per pixel.
+/// \param x,y the position near the line.
+/// \param l the level of the line. An integer level is degenerate: level
+/// l+DELTA_LEVEL is traced instead, as for a minimum.
+/// \param[out] ll the level line, of type REGULAR, closed.
+/// \param[out] attr (optional) attributes of the line.
+/// \return false if no edgel of the row is crossed, or if the line could
+/// leave the image: the border must not straddle level \a l. It never does
+/// when the border is constant, as required by extract.
+bool trace_line(const unsigned char* im, size_t w, size_t h, int ptsPixel,
+                pt_t x, pt_t y, pt_t l, LevelLine& ll, LineAttributes* attr) {
+    ll.line.clear();
+    ll.type = LevelLine::REGULAR;
+    if(l == std::floor(l))
+        l += DELTA_LEVEL;
+    ll.level = l;
+    if(w<2 || h<2 || !(0<=y && y<=h-1))
+        return false;
+    bool lower=false, higher=false; // Border values wrt l
+    for(size_t i=0; i<w; i++) {
+        lower |= (im[i]<l || im[(h-1)*w+i]<l);
+        higher |= (im[i]>l || im[(h-1)*w+i]>l);
+    }
+    for(size_t j=1; j+1<h; j++) {
+        lower |= (im[j*w]<l || im[j*w+w-1]<l);
+        higher |= (im[j*w]>l || im[j*w+w-1]>l);
+    }
+    if(lower && higher)
+        return false;
+
+    // Nearest crossed edgel [x0,x0+1] in row, alternating sides
+    const size_t row = (size_t)(y+0.5f)*w;
+    pt_t fx = std::max((pt_t)0, std::min(x, (pt_t)(w-1)));
+    size_t x0 = std::min((size_t)fx, w-2);
+    bool right = (fx-x0 >= 0.5f); // Which side is nearer
+    size_t d=0;
+    for(; d<w; d++) {
+        if(right && x0+d+1<w && crossed(im, row+x0+d, l)) {
+            x0 += d;
+            break;
+        }
+        if(d<=x0 && crossed(im, row+x0-d, l)) {
+            x0 -= d;
+            break;
+        }
+        if(!right && x0+d+1<w && crossed(im, row+x0+d, l)) {
+            x0 += d;
+            break;
+        }
+    }
+    if(d == w)
+        return false;
+
+    Point p((pt_t)x0, (pt_t)(row/w));
+    DualPixel dual(p, l, im, w);
+    HashVisit visit;
+    while(true) {
+        ll.line.push_back(p);
+        if(! dual.mark_visit(visit, 0, 0, p))
+            break;
+        dual.follow(p, l, ptsPixel, ll.line);
+    }
+    if(attr)
+        line_attributes(ll.line, *attr);
+    return true;
 }
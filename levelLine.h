@@ -50,8 +50,6 @@ struct LevelLine {
     enum Type { REGULAR=0, MIN, SADDLE, MAX };
     Type type;
     LevelLine(pt_t l, Type t=REGULAR): level(l), type(t) {}
-    void fill(unsigned char* data, size_t w, size_t h,
-              std::vector< std::vector<pt_t> >* inter=0) const;
 };
 
 std::ostream& operator<<(std::ostream& str, const LevelLine& line);
@@ -59,9 +57,36 @@ std::ostream& operator<<(std::ostream& str, const LevelLine& line);
 /// Abscissa (Inter.first) of intersection of level line of index (Inter.second)
 typedef std::pair<pt_t,size_t> Inter;
 
+/// Receive level lines as soon as they are extracted.
+struct LineSink {
+    virtual ~LineSink() {}
+    /// Level line of index \a id. Its points are stored in a buffer reused
+    /// for the next line, so \a ll is valid only during the call.
+    virtual void operator()(size_t id, const LevelLine& ll)=0;
+};
+
+struct Singular;
+class NoData;
+
+/// Attributes of a single level line.
+struct LineAttributes {
+    double area; ///< Area enclosed by the line
+    double perimeter; ///< Length of the polyline
+    Point min, max; ///< Corners of bounding box
+};
+
 void extract(const unsigned char* data, size_t w, size_t h,
              int ptsPixel,
              std::vector<LevelLine*>& ll,
-             std::vector< std::vector<Inter> >* inter=0);
+             std::vector< std::vector<Inter> >* inter=0,
+             const Singular* sing=0, const NoData* mask=0);
+void extract(const unsigned char* data, size_t w, size_t h,
+             int ptsPixel,
+             LineSink& sink,
+             std::vector< std::vector<Inter> >* inter=0,
+             const Singular* sing=0, const NoData* mask=0);
+bool trace_line(const unsigned char* im, size_t w, size_t h, int ptsPixel,
+                pt_t x, pt_t y, pt_t l, LevelLine& ll,
+                LineAttributes* attr=0);
 
 #endif
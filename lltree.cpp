@@ -9,8 +9,11 @@
 #include "lltree.h"
 #include <algorithm>
 #include <stack>
+#include <string>
 #include <cassert>
 
+const size_t LLTree::NO_PARENT;
+
 /// Constructor
 LLTree::iterator::iterator(LLTree::Node* node, TreeTraversal o)
 : n(node), order(o) {
@@ -59,17 +62,127 @@ LLTree::iterator& LLTree::iterator::operator++() {
     return *this;
 }
 
+/// Delete saddle lines without child, and update the parents and the
+/// intersections with rows of the remaining lines. With a mask, the extrema
+/// touching pixels without data are not extracted, but a saddle line can
+/// enclose only such extrema. Its parent may then be left without child too.
+static void drop_empty_saddles(std::vector<LevelLine*>& ll,
+                               std::vector<size_t>& parent,
+                               std::vector< std::vector<Inter> >& inter) {
+    const size_t n=ll.size(), NONE=LLTree::NO_PARENT;
+    std::vector<size_t> children(n, 0), empty;
+    for(size_t i=0; i<n; i++)
+        if(parent[i] != NONE)
+            ++children[parent[i]];
+    for(size_t i=0; i<n; i++)
+        if(children[i]==0 && ll[i]->type==LevelLine::SADDLE)
+            empty.push_back(i);
+    if(empty.empty())
+        return;
+    std::vector<size_t> index(n, 0); // New index of kept line, NONE if dropped
+    while(! empty.empty()) {
+        size_t i = empty.back();
+        empty.pop_back();
+        index[i] = NONE;
+        size_t p = parent[i];
+        if(p!=NONE && --children[p]==0 && ll[p]->type==LevelLine::SADDLE)
+            empty.push_back(p);
+    }
+    size_t m=0;
+    for(size_t i=0; i<n; i++)
+        if(index[i] == NONE)
+            delete ll[i];
+        else
+            index[i] = m++;
+    for(size_t i=0; i<n; i++) // Parent of a kept line is kept
+        if(index[i] != NONE) {
+            ll[index[i]] = ll[i];
+            parent[index[i]] = (parent[i]==NONE)? NONE: index[parent[i]];
+        }
+    ll.resize(m);
+    parent.resize(m);
+    std::vector< std::vector<Inter> >::iterator it=inter.begin();
+    for(; it!=inter.end(); ++it) {
+        std::vector<Inter>::iterator out=it->begin(), in=it->begin();
+        for(; in!=it->end(); ++in)
+            if(index[in->second] != NONE)
+                *out++ = Inter(in->first, index[in->second]);
+        it->erase(out, it->end());
+    }
+}
+
 /// Build tree structure of level lines: [2]Algorithm 4.
-LLTree::LLTree(const unsigned char* data, size_t w, size_t h, int ptsPixel)
+/// \param data the values of pixels in a 1D array.
+/// \param w,h the dimensions of the image.
+/// \param ptsPixel number of points of discretization per pixel.
+/// \param[out] inter (optional) intersections of level lines with each row,
+/// sorted by abscissa. The line index is the one of the node.
+/// \param sing (optional) singular points of \a data, when already found.
+/// \param mask (optional) pixels without data, where no level line passes.
+/// Saddle lines enclosing no extracted extremum are then dropped.
+LLTree::LLTree(const unsigned char* data, size_t w, size_t h, int ptsPixel,
+               std::vector< std::vector<Inter> >* inter,
+               const Singular* sing, const NoData* mask)
 : root_(0) {
     // Extract level lines
-    std::vector< std::vector<Inter> > inter;
+    std::vector< std::vector<Inter> > localInter;
+    if(! inter)
+        inter = &localInter;
     std::vector<LevelLine*> ll;
-    extract(data,w,h, ptsPixel, ll, &inter);
-    // Create nodes
-    for(std::vector<LevelLine*>::iterator it=ll.begin(); it!=ll.end(); ++it)
-        nodes_.push_back( Node(*it) );
-    // Build hierarchy (parent field only)
+    extract(data,w,h, ptsPixel, ll, inter, sing, mask);
+    std::vector<size_t> parent;
+    hierarchy(*inter, ll.size(), parent);
+    if(mask)
+        drop_empty_saddles(ll, parent, *inter);
+    adopt(ll, parent);
+}
+
+/// Check that \a parent describes a forest of \a n nodes: each parent is
+/// NO_PARENT or the index of another node, without cycle.
+static bool is_forest(size_t n, const std::vector<size_t>& parent) {
+    if(parent.size() != n)
+        return false;
+    enum {NEW, PATH, DONE};
+    std::vector<unsigned char> state(n, NEW);
+    std::vector<size_t> path;
+    for(size_t i=0; i<n; i++) {
+        size_t j=i;
+        for(; j!=LLTree::NO_PARENT && state[j]==NEW; j=parent[j]) {
+            if(parent[j]!=LLTree::NO_PARENT && parent[j]>=n)
+                return false;
+            state[j] = PATH;
+            path.push_back(j);
+        }
+        if(j!=LLTree::NO_PARENT && state[j]==PATH) // Cycle, or self-parent
+            return false;
+        for(; !path.empty(); path.pop_back())
+            state[path.back()] = DONE;
+    }
+    return true;
+}
+
+/// Build tree from level lines and the index of their parent.
+/// \param[in,out] ll the level lines, whose ownership is transferred to the
+/// tree: \a ll is emptied, but the lines are neither copied nor moved.
+/// \param parent the index in \a ll of the parent of each line, NO_PARENT
+/// for a root. If it does not describe a forest, std::string is thrown and
+/// \a ll is unchanged.
+LLTree::LLTree(std::vector<LevelLine*>& ll, const std::vector<size_t>& parent)
+: root_(0) {
+    if(! is_forest(ll.size(), parent))
+        throw std::string("Parents of level lines do not describe a forest");
+    adopt(ll, parent);
+}
+
+/// Parent of each level line from its intersections with rows: [2]Algorithm 4.
+/// \param[in,out] inter intersections of the \a n level lines with each row,
+/// as filled by extract. Each row gets sorted by abscissa.
+/// \param n the number of level lines.
+/// \param[out] parent the index of the parent of each line, NO_PARENT for a
+/// root.
+void LLTree::hierarchy(std::vector< std::vector<Inter> >& inter, size_t n,
+                       std::vector<size_t>& parent) {
+    parent.assign(n, NO_PARENT);
     std::vector< std::vector<Inter> >::iterator it = inter.begin();
     for(; it!=inter.end(); ++it) { // Iterate over image lines
         std::sort(it->begin(), it->end());
@@ -77,26 +190,67 @@ LLTree::LLTree(const unsigned char* data, size_t w, size_t h, int ptsPixel)
         std::vector<Inter>::const_iterator it2=it->begin();
         for(; it2!=it->end(); ++it2) { // Intersections with current line
             if(stack.empty()) { // Root of the tree
-                assert(!nodes_[it2->second].parent);
+                assert(parent[it2->second] == NO_PARENT);
                 stack.push(it2->second);
             } else if(stack.top()==it2->second) // Getting out of innermost line
                 stack.pop();
             else { // Getting in a line
-                assert(!nodes_[it2->second].parent ||
-                       nodes_[it2->second].parent == &nodes_[stack.top()]);
-                nodes_[it2->second].parent = &nodes_[stack.top()];
+                assert(parent[it2->second] == NO_PARENT ||
+                       parent[it2->second] == stack.top());
+                parent[it2->second] = stack.top();
                 stack.push(it2->second);
             }
         }
         assert( stack.empty() );
     }
-    complete();
+}
+
+/// Move constructor. The moved tree is left empty.
+LLTree::LLTree(LLTree&& tree)
+: nodes_(std::move(tree.nodes_)), root_(tree.root_) {
+    tree.nodes_.clear();
+    tree.root_ = 0;
+}
+
+/// Move assignment. The moved tree is left empty.
+LLTree& LLTree::operator=(LLTree&& tree) {
+    if(this != &tree) {
+        clear();
+        nodes_.swap(tree.nodes_);
+        root_ = tree.root_;
+        tree.root_ = 0;
+    }
+    return *this;
 }
 
 /// Destructor
 LLTree::~LLTree() {
+    clear();
+}
+
+/// Create a node for each level line, taking its ownership, with parent of
+/// given index. \a ll is emptied.
+void LLTree::adopt(std::vector<LevelLine*>& ll,
+                   const std::vector<size_t>& parent) {
+    assert(nodes_.empty() && ll.size() == parent.size());
+    nodes_.reserve(ll.size());
+    for(std::vector<LevelLine*>::iterator it=ll.begin(); it!=ll.end(); ++it)
+        nodes_.push_back( Node(*it) );
+    ll.clear();
+    for(size_t i=0; i<nodes_.size(); i++)
+        if(parent[i] != NO_PARENT) {
+            assert(parent[i] < nodes_.size() && parent[i] != i);
+            nodes_[i].parent = &nodes_[parent[i]];
+        }
+    complete();
+}
+
+/// Delete all nodes and their level lines.
+void LLTree::clear() {
     for(std::vector<Node>::iterator it=nodes_.begin(); it!=nodes_.end(); ++it)
         delete it->ll;
+    nodes_.clear();
+    root_ = 0;
 }
 
 /// Fill root_ and fields child, sibling of all nodes, using field parent only.
@@ -13,7 +13,9 @@
 
 typedef enum {PreOrder, PostOrder} TreeTraversal;
 
-/// Tree structure of level lines
+/// Tree structure of level lines. The tree owns its level lines. It can be
+/// moved but not copied; moving keeps nodes in place, so pointers to nodes
+/// stay valid.
 class LLTree {
 public:
     struct Node {
@@ -38,13 +40,28 @@ public:
     iterator end() { return iterator(0); }
     std::vector<Node>& nodes() { return nodes_; }
 
-    LLTree(const unsigned char* data, size_t w, size_t h, int ptsPixel);
+    /// Value of parent index for a root.
+    static const size_t NO_PARENT = (size_t)-1;
+
+    LLTree(const unsigned char* data, size_t w, size_t h, int ptsPixel,
+           std::vector< std::vector<Inter> >* inter=0,
+           const Singular* sing=0, const NoData* mask=0);
+    LLTree(std::vector<LevelLine*>& ll, const std::vector<size_t>& parent);
+    LLTree(LLTree&& tree);
+    LLTree& operator=(LLTree&& tree);
+    LLTree(const LLTree&) = delete;
+    LLTree& operator=(const LLTree&) = delete;
     ~LLTree();
     Node* root() { return root_; }
+    static void hierarchy(std::vector< std::vector<Inter> >& inter, size_t n,
+                          std::vector<size_t>& parent);
 private:
-    std::vector<Node> nodes_;
+    std::vector<Node> nodes_; ///< Each one owns its level line
     Node* root_;
+    void adopt(std::vector<LevelLine*>& ll,
+               const std::vector<size_t>& parent);
     void complete();
+    void clear();
 };
 
 #endif
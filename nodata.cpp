@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file nodata.cpp
+ * @brief Pixels without data, ignored by the extraction of level lines
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "nodata.h"
+
+/// Constructor from a mask: pixel i has data if \a valid[i] is not 0.
+NoData::NoData(const unsigned char* valid, size_t w, size_t h)
+: w_(w), h_(h), pixel_(w*h) {
+    for(size_t i=0; i<w*h; i++)
+        pixel_[i] = (valid[i]!=0);
+    init();
+}
+
+/// Constructor from a reserved \a value of image \a im, meaning no data.
+NoData::NoData(const unsigned char* im, size_t w, size_t h,
+               unsigned char value)
+: w_(w), h_(h), pixel_(w*h) {
+    for(size_t i=0; i<w*h; i++)
+        pixel_[i] = (im[i]!=value);
+    init();
+}
+
+/// Compute valid dual pixels and the runs of rows.
+void NoData::init() {
+    dual_.assign(w_*h_, 0);
+    for(size_t y=0; y+1<h_; y++) {
+        const unsigned char *p=&pixel_[y*w_], *q=p+w_;
+        unsigned char* d = &dual_[y*w_];
+        for(size_t x=0; x+1<w_; x++)
+            d[x] = (p[x] & p[x+1] & q[x] & q[x+1]);
+    }
+    runs(pixel_, w_, h_, pixelRuns_, pixelRow_);
+    runs(dual_, w_, h_, dualRuns_, dualRow_);
+}
+
+/// Runs of non-zero values of each row of \a m, of size \a w x \a h.
+/// \param[out] run the runs, row by row.
+/// \param[out] row the index in \a run of the first run of each row, then
+/// the number of runs.
+void NoData::runs(const std::vector<unsigned char>& m, size_t w, size_t h,
+                  std::vector<Span>& run, std::vector<size_t>& row) {
+    run.clear();
+    row.resize(h+1);
+    for(size_t y=0; y<h; y++) {
+        row[y] = run.size();
+        const unsigned char* r = &m[y*w];
+        for(size_t x=0; x<w;) {
+            for(; x<w && !r[x]; x++);
+            if(x == w)
+                break;
+            Span s;
+            s.x0 = (unsigned int)x;
+            for(; x<w && r[x]; x++);
+            s.x1 = (unsigned int)x;
+            run.push_back(s);
+        }
+    }
+    row[h] = run.size();
+}
+
+/// Runs of valid pixels of row \a y, in [first,last).
+void NoData::pixels(size_t y, const Span*& first, const Span*& last) const {
+    first = pixelRuns_.data()+pixelRow_[y];
+    last  = pixelRuns_.data()+pixelRow_[y+1];
+}
+
+/// Runs of valid dual pixels of top-left vertex in row \a y, in [first,last).
+void NoData::duals(size_t y, const Span*& first, const Span*& last) const {
+    first = dualRuns_.data()+dualRow_[y];
+    last  = dualRuns_.data()+dualRow_[y+1];
+}
+
+/// Number of pixels with data.
+size_t NoData::count() const {
+    size_t n=0;
+    for(std::vector<Span>::const_iterator it=pixelRuns_.begin();
+        it!=pixelRuns_.end(); ++it)
+        n += it->x1-it->x0;
+    return n;
+}
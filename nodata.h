@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file nodata.h
+ * @brief Pixels without data, ignored by the extraction of level lines
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef NODATA_H
+#define NODATA_H
+
+#include <vector>
+#include <cstddef>
+
+/// Validity of the pixels of an image, from a mask or a reserved value.
+/// Pixels without data are a boundary for the extraction: a level line
+/// entering a dual pixel with a vertex without data is dropped, and extrema
+/// and saddles touching such a pixel are ignored.
+/// Rows are also stored as runs of valid pixels and of valid dual pixels, so
+/// that scans of the image skip the regions without data.
+class NoData {
+public:
+    struct Span { unsigned int x0, x1; }; ///< Columns [x0,x1) of a row
+
+    NoData(const unsigned char* valid, size_t w, size_t h);
+    NoData(const unsigned char* im, size_t w, size_t h, unsigned char value);
+    /// Has pixel of index \a i data?
+    bool pixel(size_t i) const { return pixel_[i]!=0; }
+    /// Have all vertices of dual pixel of top-left vertex \a i data?
+    bool dual(size_t i) const { return dual_[i]!=0; }
+    void pixels(size_t y, const Span*& first, const Span*& last) const;
+    void duals(size_t y, const Span*& first, const Span*& last) const;
+    size_t count() const; ///< Number of pixels with data
+private:
+    size_t w_, h_;
+    std::vector<unsigned char> pixel_, dual_;
+    std::vector<Span> pixelRuns_, dualRuns_;
+    std::vector<size_t> pixelRow_, dualRow_; ///< First run of each row
+    void init();
+    static void runs(const std::vector<unsigned char>& m, size_t w, size_t h,
+                     std::vector<Span>& run, std::vector<size_t>& row);
+};
+
+#endif
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file perf_counters.cpp
+ * @brief Hardware performance counters, through Linux perf_event_open
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+/// Open counter of given type and config for the calling thread.
+/// Return the file descriptor, -1 in case of failure.
+static int open_counter(unsigned int type, unsigned long long config) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/// Constructor, opening and starting all available counters.
+PerfCounters::PerfCounters() {
+    for(int i=0; i<NB_EVENTS; i++)
+        fd_[i] = -1;
+#ifdef __linux__
+    const unsigned long long l1d = PERF_COUNT_HW_CACHE_L1D |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    fd_[CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fd_[INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE,
+                                     PERF_COUNT_HW_INSTRUCTIONS);
+    fd_[BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE,
+                                      PERF_COUNT_HW_BRANCH_MISSES);
+    fd_[L1D_MISSES] = open_counter(PERF_TYPE_HW_CACHE, l1d);
+    fd_[LLC_MISSES] = open_counter(PERF_TYPE_HARDWARE,
+                                   PERF_COUNT_HW_CACHE_MISSES);
+#endif
+}
+
+/// Destructor, closing counters.
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for(int i=0; i<NB_EVENTS; i++)
+        if(fd_[i] >= 0)
+            close(fd_[i]);
+#endif
+}
+
+/// Is at least one counter available?
+bool PerfCounters::any() const {
+    for(int i=0; i<NB_EVENTS; i++)
+        if(fd_[i] >= 0)
+            return true;
+    return false;
+}
+
+/// Current values of counters, -1 for unavailable ones.
+void PerfCounters::read(long long values[NB_EVENTS]) const {
+    for(int i=0; i<NB_EVENTS; i++) {
+        values[i] = -1;
+#ifdef __linux__
+        long long v;
+        if(fd_[i] >= 0 && ::read(fd_[i], &v, sizeof(v)) == sizeof(v))
+            values[i] = v;
+#endif
+    }
+}
+
+/// Short name of the event.
+const char* PerfCounters::name(Event e) {
+    static const char* names[NB_EVENTS] =
+        {"cycles", "instr", "br-miss", "L1d-miss", "LLC-miss"};
+    return names[e];
+}
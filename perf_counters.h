@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file perf_counters.h
+ * @brief Hardware performance counters, through Linux perf_event_open
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/// Hardware counters of the calling thread, counting in user space since
+/// construction. Counters that cannot be opened (other OS, no permission,
+/// virtual machine without PMU...) are reported as unavailable.
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES,
+                 NB_EVENTS };
+    PerfCounters();
+    ~PerfCounters();
+    bool available(Event e) const { return fd_[e] >= 0; }
+    bool any() const;
+    void read(long long values[NB_EVENTS]) const;
+    static const char* name(Event e);
+private:
+    int fd_[NB_EVENTS];
+    PerfCounters(const PerfCounters&); // Not copyable
+    PerfCounters& operator=(const PerfCounters&);
+};
+
+#endif
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file progressive.cpp
+ * @brief Coarse to fine extraction of the tree of level lines
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "progressive.h"
+#include <algorithm>
+
+/// Downsample image by factor \a s, averaging the pixels of each block of
+/// s x s pixels (less at right and bottom borders if \a s does not divide the
+/// dimensions). The border of the result is set to the level of the border of
+/// \a im, assumed constant, as required by the extraction.
+static unsigned char* downsample(const unsigned char* im, size_t w, size_t h,
+                                 int s, size_t& w2, size_t& h2) {
+    w2 = (w+s-1)/s;
+    h2 = (h+s-1)/s;
+    unsigned char* out = new unsigned char[w2*h2];
+    std::vector<unsigned int> sum(w2);
+    for(size_t y2=0; y2<h2; y2++) {
+        std::fill(sum.begin(), sum.end(), 0);
+        size_t y=y2*s, yend=std::min(y+s,h);
+        for(; y<yend; y++)
+            for(size_t x=0; x<w; x++)
+                sum[x/s] += im[y*w+x];
+        size_t rows = yend-y2*s;
+        for(size_t x2=0; x2<w2; x2++) {
+            size_t n = rows*(std::min((x2+1)*s,w)-x2*s);
+            out[y2*w2+x2] = (unsigned char)((sum[x2]+n/2)/n);
+        }
+    }
+    const unsigned char b = im[0];
+    for(size_t x=0; x<w2; x++)
+        out[x] = out[(h2-1)*w2+x] = b;
+    for(size_t y=0; y<h2; y++)
+        out[y*w2] = out[y*w2+w2-1] = b;
+    return out;
+}
+
+/// Map points of the tree extracted at scale \a s to full resolution: the
+/// center of pixel x at scale s is at s*x+(s-1)/2.
+static void upscale(LLTree& tree, int s) {
+    const pt_t off = (s-1)/(pt_t)2;
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    for(size_t i=0; i<nodes.size(); i++) {
+        std::vector<Point>& line = nodes[i].ll->line;
+        for(std::vector<Point>::iterator it=line.begin(); it!=line.end(); ++it)
+            *it = Point(s*it->x+off, s*it->y+off);
+    }
+}
+
+/// Is the exact tree already extracted?
+static bool is_done(const bool& done) {
+    bool d;
+#ifdef _OPENMP
+#pragma omp critical(progressive)
+#endif
+    d = done;
+    return d;
+}
+
+/// Extract the tree of level lines, delivering first coarse approximations.
+/// The image is downsampled by factors \a coarsest, coarsest/2..., 2, whose
+/// trees show quickly the main structures, before the exact tree.
+/// With OpenMP, the exact tree is extracted concurrently with the coarse ones,
+/// so that it is not delayed much; coarse trees not ready when it is finished
+/// are skipped.
+/// \param data the values of pixels, the border being constant.
+/// \param w,h the dimensions of the image.
+/// \param ptsPixel number of points of discretization per pixel.
+/// \param coarsest the coarsest downsampling factor.
+/// \param sink the receiver of the successive trees.
+void extract_progressive(const unsigned char* data, size_t w, size_t h,
+                         int ptsPixel, int coarsest, ProgressSink& sink) {
+    LLTree* tree = 0;
+    bool done = false;
+#ifdef _OPENMP
+#pragma omp parallel sections num_threads(2)
+#endif
+    {
+#ifdef _OPENMP
+#pragma omp section
+#endif
+        for(int s=coarsest; s>1 && !is_done(done); s/=2) {
+            size_t w2, h2;
+            unsigned char* im = downsample(data, w, h, s, w2, h2);
+            if(w2>=3 && h2>=3) { // Otherwise nothing but the border
+                LLTree coarse(im, w2, h2, ptsPixel);
+                upscale(coarse, s);
+                if(! is_done(done))
+                    sink(s, coarse);
+            }
+            delete [] im;
+        }
+#ifdef _OPENMP
+#pragma omp section
+#endif
+        {
+            tree = new LLTree(data, w, h, ptsPixel);
+#ifdef _OPENMP
+#pragma omp critical(progressive)
+#endif
+            done = true;
+        }
+    }
+    sink(1, *tree);
+    delete tree;
+}
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file progressive.h
+ * @brief Coarse to fine extraction of the tree of level lines
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+
+#include "lltree.h"
+
+/// Receive successive approximations of the tree of level lines.
+struct ProgressSink {
+    virtual ~ProgressSink() {}
+    /// Tree extracted from the image downsampled by factor \a scale, 1 for
+    /// the exact tree, which comes last. Scales are decreasing from one call
+    /// to the next, and calls are never concurrent. Coordinates are the ones
+    /// of the full resolution image. The tree is valid only during the call.
+    virtual void operator()(int scale, LLTree& tree)=0;
+};
+
+void extract_progressive(const unsigned char* data, size_t w, size_t h,
+                         int ptsPixel, int coarsest, ProgressSink& sink);
+
+#endif
@@ -7,18 +7,29 @@
  */
 
 #include "lltree.h"
+#include "ingest.h"
+#include "border.h"
+#include "singular.h"
 #include "draw_curve.h"
 #include "fill_curve.h"
+#include "coverage.h"
+#include "progressive.h"
+#include "validate.h"
+#include "distance_field.h"
+#include "scale_space.h"
 #include "cmdLine.h"
 #include "io_png.h"
+#include <algorithm>
 #include <map>
-
-struct color_t {
-    unsigned char r,g,b;
-    color_t(): r(255), g(255), b(255) {}
-    color_t(unsigned char r0, unsigned char g0, unsigned char b0)
-    :r(r0),g(g0),b(b0) {}
-};
+#include <string>
+#include <cmath>
+#include <cerrno>
+#include <fstream>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 struct TransformZoom : public TransformPoint {
     int z;
@@ -28,54 +39,568 @@ struct TransformZoom : public TransformPoint {
     }
 };
 
-const color_t WHITE(255,255,255);
-const color_t GREEN(0,255,0);
-
-/// Compute histogram of level at pixels at the border of the image.
-static void histogram(unsigned char* im, size_t w, size_t h, size_t histo[256]){
-    size_t j;
-    for(j=0; j<w; j++) // First line
-        ++histo[im[j]];
-    for(size_t i=1; i+1<h; i++) { // All lines except first and last
-        ++histo[im[j]];  // First pixel of line
-        j+= w-1;
-        ++histo[im[j++]]; // Last pixel of line
-    }
-    for(; j<w*h; j++) // Last line
-        ++histo[im[j]];    
-}
-
-/// Put pixels at border of image to value \a v.
-static void put_border(unsigned char* im, size_t w, size_t h, unsigned char v) {
-    size_t j;
-    for(j=0; j<w; j++)
-        im[j] = v;
-    for(size_t i=1; i+1<h; i++) {
-        im[j] = v;
-        j+= w-1;
-        im[j++] = v;
-    }
-    for(; j<w*h; j++)
-        im[j] = v;
-}
-
-/// Set all pixels at border of image to their median level.
-static unsigned char fill_border(unsigned char* im, size_t w, size_t h) {
-    size_t histo[256] = {0}; // This puts all values to zero
-    histogram(im, w, h, histo);
-    size_t limit=w+h-2; // Half number of pixels at border
-    size_t sum=0;
-    int i=-1;
-    while((sum+=histo[++i]) < limit);
-    put_border(im,w,h, (unsigned char)i);
-    return (unsigned char)i;
+/// Output colors: one per type of level line (index LevelLine::Type), then
+/// background. The output image stores indices in this palette.
+const unsigned char palette[] = {  0,  0,  0,   0,  0,255,   0,255,  0,
+                                 255,  0,  0, 255,255,255};
+const unsigned char WHITE=4; ///< Index of background color in palette
+
+/// Is the node filled (extremum) or drawn?
+static bool filled(const LLTree::Node& n) {
+    return (n.ll->type == LevelLine::MIN || n.ll->type == LevelLine::MAX);
+}
+
+/// Palette index of color of the node.
+static unsigned char color(const LLTree::Node& n) {
+    if(filled(n) && n.parent && n.parent->ll->type==n.ll->type)
+        return WHITE;
+    return (unsigned char)n.ll->type;
+}
+
+/// Draw level lines of the tree in canvas \a c. Extrema are filled, other
+/// level lines are drawn.
+/// If \a cross is given (zoom 1 only), fill from the row crossings recorded
+/// during extraction rather than from the polylines.
+template <class Canvas>
+static void render(LLTree& tree, Canvas& c, const TransformPoint& t,
+                   const LineCrossings* cross=0) {
+    const LLTree::Node* base = tree.nodes().empty()? 0: &tree.nodes()[0];
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it) {
+        unsigned char color = ::color(*it);
+        if(filled(*it)) {
+            if(cross)
+                cross->fill(&*it-base, it->ll->line, color, c);
+            else
+                fill_curve(it->ll->line, color, c, t);
+        } else
+            draw_curve(it->ll->line, color, c, t);
+    }
+}
+
+/// Output of row \a y of a SpanCanvas<unsigned char> for PNG writing.
+static void span_row(size_t y, unsigned char* row, void* canvas) {
+    static_cast<const SpanCanvas<unsigned char>*>(canvas)->row((int)y, row);
+}
+
+/// Anti-aliased rendering of the tree, by bands of rows.
+struct AARender {
+    /// Consecutive segments [first,last) of a level line crossing a band.
+    struct Run {
+        const LLTree::Node* node;
+        size_t first, last;
+    };
+    std::vector< std::vector<Run> > runs; ///< For each band, in pre-order
+    const TransformPoint& t;
+    Coverage cov;
+    std::vector<float> rgb; ///< Current band, RGB
+    int w, y0; ///< Width, first row of current band
+    AARender(LLTree& tree, const TransformPoint& t, int w, int h, int band);
+    void render(int y);
+};
+
+/// Constructor.
+/// \param tree the tree of level lines.
+/// \param t the transform from image to output coordinates.
+/// \param w,h the dimensions of output.
+/// \param band the number of rows rendered at once.
+/// Segments of level lines are distributed among the bands they cross, so
+/// that each band handles only its own segments.
+AARender::AARender(LLTree& tree, const TransformPoint& t0, int w0, int h,
+                   int band)
+: runs((h+band-1)/band), t(t0), cov(w0,band), rgb(3*w0*band), w(w0),
+  y0(-band) {
+    const int nb = (int)runs.size();
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it) {
+        const std::vector<Point>& line = it->ll->line;
+        pt_t y = t(line.front()).y;
+        for(size_t i=0; i+1<line.size(); i++) {
+            pt_t y2 = t(line[i+1]).y;
+            // Margin for half pixel shift and stroke width
+            int b1 = std::max(0,   (int)std::floor(std::min(y,y2)-1)/band);
+            int b2 = std::min(nb-1,(int)std::floor(std::max(y,y2)+2)/band);
+            for(int b=b1; b<=b2; b++) {
+                std::vector<Run>& r = runs[b];
+                if(!r.empty() && r.back().node==&*it && r.back().last==i)
+                    ++r.back().last;
+                else {
+                    Run run = {&*it, i, i+1};
+                    r.push_back(run);
+                }
+            }
+            y = y2;
+        }
+    }
+}
+
+/// Render the band of rows starting at \a y.
+void AARender::render(int y) {
+    y0 = y;
+    std::fill(rgb.begin(), rgb.end(), 255.0f);
+    cov.start(y0);
+    const std::vector<Run>& r = runs[y0/cov.band()];
+    for(std::vector<Run>::const_iterator it=r.begin(); it!=r.end();) {
+        const LLTree::Node* n = it->node;
+        for(; it!=r.end() && it->node==n; ++it)
+            if(filled(*n))
+                cov.fill(n->ll->line, t, it->first, it->last);
+            else
+                cov.stroke(n->ll->line, t, it->first, it->last);
+        cov.blend(&palette[3*color(*n)], &rgb[0]);
+    }
+}
+
+/// Output of row \a y of an AARender for PNG writing.
+static void aa_row(size_t y, unsigned char* row, void* render) {
+    AARender* r = static_cast<AARender*>(render);
+    if((int)y >= r->y0+r->cov.band())
+        r->render((int)y);
+    const float* in = &r->rgb[3*(y-r->y0)*r->w];
+    for(int i=0; i<3*r->w; i++)
+        row[i] = (unsigned char)(in[i]+.5f);
+}
+
+/// Output modes of the image.
+enum Mode { DENSE, SPARSE, ANTIALIAS };
+
+/// Dense canvas of w x h pixels, set to background.
+static unsigned char* new_canvas(size_t w, size_t h) {
+    unsigned char* out = new unsigned char[w*h];
+    std::fill(out, out+w*h, WHITE);
+    return out;
+}
+
+/// Draw the tree in PNG image file \a fname with zoom factor \a z.
+/// In DENSE mode, \a canvas can be given, from new_canvas with the output
+/// dimensions; it is deleted.
+/// Return 0 if successful, -1 otherwise.
+static int write_tree(LLTree& tree, size_t w, size_t h, int z, Mode mode,
+                      const LineCrossings* cross, const char* fname,
+                      unsigned char* canvas=0) {
+    TransformZoom t(z);
+    w *= z;
+    h *= z;
+    int err;
+    if(mode == ANTIALIAS) {
+        AARender out(tree, t, (int)w, (int)h, 64);
+        err = io_png_write_u8_rows(fname, w, h, 3, aa_row, &out);
+    } else if(mode == SPARSE) {
+        SpanCanvas<unsigned char> out((int)w, (int)h, WHITE);
+        render(tree, out, t, cross);
+        err = io_png_write_u8_palette_rows(fname, w, h,
+                                           palette, sizeof(palette)/3,
+                                           span_row, &out);
+    } else {
+        unsigned char* out = canvas? canvas: new_canvas(w, h);
+        DenseCanvas<unsigned char> c(out, (int)w, (int)h);
+        render(tree, c, t, cross);
+        err = io_png_write_u8_palette(fname, out, w, h,
+                                      palette, sizeof(palette)/3);
+        delete [] out;
+    }
+    return err;
+}
+
+/// Transform from image to tile coordinates: zoom by factor s, then
+/// translation to the tile origin (x0,y0).
+struct TransformTile : public TransformPoint {
+    pt_t s, x0, y0;
+    TransformTile(pt_t scale, pt_t ox=0, pt_t oy=0): s(scale), x0(ox), y0(oy) {}
+    Point operator()(const Point& p) const {
+        return Point(s*p.x-x0, s*p.y-y0);
+    }
+};
+
+/// Bounds of intervals inside a filled level line, in the rows of a tile.
+struct TileBounds {
+    int x0, y0; ///< Origin of tile
+    std::vector< std::vector<pt_t> > rows;
+};
+
+/// Add bound \a x of interval of row \a iy, called by PolyIterator.
+static void bound(TileBounds& b, pt_t x, int iy) {
+    iy -= b.y0;
+    if(0<=iy && iy<(int)b.rows.size())
+        b.rows[iy].push_back(x-b.x0);
+}
+
+/// Create directory \a dir if it does not exist. Return false on failure.
+static bool make_dir(const std::string& dir) {
+#ifdef _WIN32
+    int err = _mkdir(dir.c_str());
+#else
+    int err = mkdir(dir.c_str(), 0755);
+#endif
+    return (err==0 || errno==EEXIST);
+}
+
+/// Pyramid of map tiles in XYZ layout: tile (x,y) of level k is the file
+/// dir/k/x/y.png. The finest level is drawn at the zoom of extraction and each
+/// coarser level at half the scale of the next one, down to level 0 fitting in
+/// a single tile.
+class TilePyramid {
+public:
+    TilePyramid(LLTree& tree, size_t w, size_t h, int z, int tile);
+    int levels() const { return levels_; }
+    int write(int level, const std::string& dir);
+    size_t written, empty; ///< Numbers of tiles written and skipped
+private:
+    LLTree& tree_;
+    size_t w_, h_;
+    int z_, T_;
+    int levels_;
+    /// Bounding boxes of level lines in image coordinates, in pre-order
+    std::vector<const LLTree::Node*> nodes_;
+    std::vector<pt_t> box_; ///< xmin, ymin, xmax, ymax of each node
+    void decimate(const std::vector<Point>& line, pt_t s,
+                  std::vector<Point>& out) const;
+    bool render(pt_t s, int tx, int ty,
+                std::vector<const LLTree::Node*>::const_iterator first,
+                std::vector<const LLTree::Node*>::const_iterator last,
+                const std::vector< std::vector<Point> >& lines,
+                unsigned char* im, TileBounds& tb) const;
+};
+
+/// Constructor.
+/// \param tree the tree of level lines.
+/// \param w,h the dimensions of the image.
+/// \param z the zoom factor of the finest level.
+/// \param tile the side of tiles.
+TilePyramid::TilePyramid(LLTree& tree, size_t w, size_t h, int z, int tile)
+: written(0), empty(0), tree_(tree), w_(w), h_(h), z_(z), T_(tile),
+  levels_(1) {
+    for(size_t side=std::max(w,h)*z; side>(size_t)tile; side=(side+1)/2)
+        ++levels_;
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it) {
+        const std::vector<Point>& line = it->ll->line;
+        if(line.empty())
+            continue;
+        pt_t b[4] = {line[0].x, line[0].y, line[0].x, line[0].y};
+        for(std::vector<Point>::const_iterator p=line.begin();
+            p!=line.end(); ++p) {
+            b[0] = std::min(b[0], p->x); b[1] = std::min(b[1], p->y);
+            b[2] = std::max(b[2], p->x); b[3] = std::max(b[3], p->y);
+        }
+        nodes_.push_back(&*it);
+        box_.insert(box_.end(), b, b+4);
+    }
+}
+
+/// Keep the vertices of \a line at least one pixel apart at scale \a s, and
+/// its last one: the sampling density matches the output resolution.
+void TilePyramid::decimate(const std::vector<Point>& line, pt_t s,
+                           std::vector<Point>& out) const {
+    out.clear();
+    for(size_t i=0; i<line.size(); i++)
+        if(out.empty() || i+1==line.size() ||
+           s*std::max(std::abs(line[i].x-out.back().x),
+                      std::abs(line[i].y-out.back().y)) >= 1)
+            out.push_back(line[i]);
+}
+
+/// Render tile (\a tx,\a ty) at scale \a s from the nodes intersecting it,
+/// [first,last) in pre-order. \a lines are the decimated lines of drawn nodes,
+/// if any. \a tb is a buffer. Return false if the tile is only background.
+bool TilePyramid::render(pt_t s, int tx, int ty,
+                         std::vector<const LLTree::Node*>::const_iterator first,
+                         std::vector<const LLTree::Node*>::const_iterator last,
+                         const std::vector< std::vector<Point> >& lines,
+                         unsigned char* im, TileBounds& tb) const {
+    std::fill(im, im+T_*T_, WHITE);
+    DenseCanvas<unsigned char> c(im, T_, T_);
+    tb.x0 = tx*T_;
+    tb.y0 = ty*T_;
+    const TransformTile zoom(s), t(s, (pt_t)tb.x0, (pt_t)tb.y0);
+    const LLTree::Node* base = tree_.nodes().empty()? 0: &tree_.nodes()[0];
+    for(std::vector<const LLTree::Node*>::const_iterator it=first; it!=last;
+        ++it) {
+        const std::vector<Point>& line = (*it)->ll->line;
+        unsigned char v = color(**it);
+        if(! filled(**it)) {
+            draw_curve(lines.empty()? line: lines[*it-base], v, c, t);
+            continue;
+        }
+        // Same rules as fill_curve in the full image, restricted to the tile
+        PolyIterator p(line, zoom);
+        if(p.dir==0) {
+            fill_point(t(line.front()), v, c);
+            continue;
+        }
+        for(size_t i=0; i<tb.rows.size(); i++)
+            tb.rows[i].clear();
+        std::vector<Point>::const_iterator q=line.begin()+1;
+        for(; q!=line.end(); ++q)
+            p.add_point(zoom(*q), tb);
+        p.add_point(zoom(line.front()), tb);
+        for(int y=0; y<T_; y++)
+            if(! tb.rows[y].empty())
+                fill_line(v, c, y, tb.rows[y]);
+    }
+    for(int i=0; i<T_*T_; i++)
+        if(im[i] != WHITE)
+            return true;
+    return false;
+}
+
+/// Write the tiles of \a level in directory \a dir, in parallel. Only the
+/// nodes whose bounding box meets a tile are rendered in it, and tiles
+/// without any such node are skipped without rendering, as well as tiles
+/// rendered as background only.
+/// Return 0 if successful, -1 otherwise.
+int TilePyramid::write(int level, const std::string& dir) {
+    const pt_t s = z_/std::pow((pt_t)2, (pt_t)(levels_-1-level));
+    const int nx = (int)((std::ceil(w_*s)+T_-1)/T_);
+    const int ny = (int)((std::ceil(h_*s)+T_-1)/T_);
+    const std::string base = dir + '/' + std::to_string(level);
+    if(! make_dir(base))
+        return -1;
+
+    // Nodes of each tile, by counting sort in pre-order
+    std::vector<size_t> first((size_t)nx*ny+1, 0);
+    std::vector<int> range(4*nodes_.size()); // Tiles tx0, ty0, tx1, ty1
+    for(size_t i=0; i<nodes_.size(); i++) {
+        const pt_t* b = &box_[4*i];
+        int* r = &range[4*i];
+        r[0] = std::max(0,    (int)std::floor((s*b[0]-1)/T_));
+        r[1] = std::max(0,    (int)std::floor((s*b[1]-1)/T_));
+        r[2] = std::min(nx-1, (int)std::floor((s*b[2]+1)/T_));
+        r[3] = std::min(ny-1, (int)std::floor((s*b[3]+1)/T_));
+        for(int ty=r[1]; ty<=r[3]; ty++)
+            for(int tx=r[0]; tx<=r[2]; tx++)
+                ++first[(size_t)ty*nx+tx+1];
+    }
+    for(size_t k=0; k+1<first.size(); k++)
+        first[k+1] += first[k];
+    std::vector<const LLTree::Node*> nodes(first.back());
+    std::vector<size_t> pos(first.begin(), first.end()-1);
+    for(size_t i=0; i<nodes_.size(); i++) {
+        const int* r = &range[4*i];
+        for(int ty=r[1]; ty<=r[3]; ty++)
+            for(int tx=r[0]; tx<=r[2]; tx++)
+                nodes[pos[(size_t)ty*nx+tx]++] = nodes_[i];
+    }
+    std::vector<int>().swap(range);
+
+    std::vector< std::vector<Point> > lines; // Decimated, if scale<1
+    if(s < 1) {
+        const LLTree::Node* b = tree_.nodes().empty()? 0: &tree_.nodes()[0];
+        lines.resize(tree_.nodes().size());
+        for(size_t i=0; i<nodes_.size(); i++)
+            if(! filled(*nodes_[i]))
+                decimate(nodes_[i]->ll->line, s, lines[nodes_[i]-b]);
+    }
+    std::vector<int> tiles; // Non-empty, column by column
+    for(int tx=0; tx<nx; tx++) {
+        bool any = false;
+        for(int ty=0; ty<ny; ty++)
+            if(first[(size_t)ty*nx+tx] < first[(size_t)ty*nx+tx+1]) {
+                tiles.push_back(ty*nx+tx);
+                any = true;
+            }
+        if(any && !make_dir(base + '/' + std::to_string(tx)))
+            return -1;
+    }
+    empty += (size_t)nx*ny - tiles.size();
+
+    int err=0;
+    size_t count=0;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<unsigned char> im((size_t)T_*T_);
+        TileBounds tb;
+        tb.rows.resize(T_);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic) reduction(+:count) reduction(|:err)
+#endif
+        for(int k=0; k<(int)tiles.size(); k++) {
+            const int tx=tiles[k]%nx, ty=tiles[k]/nx;
+            if(! render(s, tx, ty, nodes.begin()+first[tiles[k]],
+                        nodes.begin()+first[tiles[k]+1], lines, &im[0], tb))
+                continue;
+            std::string f = base + '/' + std::to_string(tx) + '/' +
+                std::to_string(ty) + ".png";
+            err |= io_png_write_u8_palette(f.c_str(), &im[0], T_, T_,
+                                           palette, sizeof(palette)/3);
+            ++count;
+        }
+    }
+    written += count;
+    empty += tiles.size() - count;
+    return (err==0)? 0: -1;
+}
+
+/// Write the tile pyramid of the tree in directory \a dir.
+/// Return 0 if successful, -1 otherwise.
+static int write_tiles(LLTree& tree, size_t w, size_t h, int z, int tile,
+                       const char* dir) {
+    TilePyramid pyramid(tree, w, h, z, tile);
+    if(! make_dir(dir))
+        return -1;
+    for(int k=0; k<pyramid.levels(); k++)
+        if(pyramid.write(k, dir) != 0)
+            return -1;
+    std::cout << "Tiles: " << pyramid.written << " written, "
+              << pyramid.empty << " empty skipped, levels 0-"
+              << pyramid.levels()-1 << '.' << std::endl;
+    return 0;
 }
 
+/// Write the signed distance field to the level lines whose type is in
+/// \a types (m: min, M: max, s: saddle) in 8-bit PNG file \a fname, with
+/// \a z samples per pixel.
+/// Return 0 if successful, -1 otherwise.
+static int write_field(LLTree& tree, size_t w, size_t h, int z,
+                       const std::string& types, const char* fname) {
+    static const char letter[] = "rmsM"; // Index LevelLine::Type
+    std::vector<const LevelLine*> lines;
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it)
+        if(types.find(letter[it->ll->type]) != std::string::npos)
+            lines.push_back(it->ll);
+    w *= z;
+    h *= z;
+    std::vector<float> d(w*h);
+    distance_field(lines, (int)w, (int)h, TransformZoom(z), &d[0]);
+    std::vector<unsigned char> out(w*h);
+    for(size_t i=0; i<w*h; i++)
+        out[i] = encode_distance(d[i]);
+    std::cout << "Field: " << lines.size() << " level lines, "
+              << w << 'x' << h << " samples." << std::endl;
+    return io_png_write_u8(fname, &out[0], w, h, 1);
+}
+
+/// Print the number of level lines of each type.
+static void print_stats(LLTree& tree) {
+    int stats[4] = {0};
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it)
+        ++stats[it->ll->type];
+    std::cout <<   "Min: "     << stats[LevelLine::MIN]
+              << ". Max: "     << stats[LevelLine::MAX]
+              << ". Saddles: " << stats[LevelLine::SADDLE]
+              << '.' << std::endl;
+}
+
+/// Validate the tree if \a rowStep>0, checking nesting every rowStep rows.
+/// Return false if an invariant is violated.
+static bool check_tree(LLTree& tree, int rowStep) {
+    if(rowStep <= 0)
+        return true;
+    Validation v = validate_tree(tree, rowStep);
+    std::cout << "Validation: " << v << std::endl;
+    return v.ok();
+}
+
+/// Write the trees of \a n Gaussian scales sqrt(2)^k of the image: the
+/// drawing of tree k in file prefix<k>.png, and the links between nodes of
+/// adjacent scales in text file prefixlinks.txt, one per line "k i j change":
+/// node i of scale k and node j of scale k+1 (indices in nodes()) are the
+/// same, or j is a part of i split, or i is a part of j merged.
+/// Return 0 if successful, -1 otherwise. \a valid gets the validation of all
+/// trees if \a rowStep>0.
+static int write_scales(const unsigned char* in, size_t w, size_t h, int z,
+                        Mode mode, int n, const std::string& prefix,
+                        int rowStep, bool& valid) {
+    static const char* change[] = {"same", "", "", "split", "merged"};
+    std::vector<double> sigmas(n);
+    for(int k=0; k<n; k++)
+        sigmas[k] = std::pow(2.0, k/2.0);
+    ScaleSpace space(in, w, h, z-1, sigmas);
+    std::ofstream links((prefix+"links.txt").c_str());
+    valid = true;
+    for(size_t k=0; k<space.size(); k++) {
+        LLTree& tree = space.tree(k);
+        std::string fname = prefix + std::to_string(k) + ".png";
+        if(write_tree(tree, w, h, z, mode, 0, fname.c_str()) != 0)
+            return -1;
+        size_t count=0;
+        if(k+1 < space.size()) {
+            const TreeMatch& m = space.links(k);
+            for(size_t i=0; i<m.matchA.size(); i++)
+                if(m.matchA[i] != TreeMatch::NONE) {
+                    links << k << ' ' << i << ' ' << m.matchA[i] << ' '
+                          << change[m.changeA[i]] << '\n';
+                    ++count;
+                }
+            for(size_t j=0; j<m.matchB.size(); j++)
+                if(m.changeB[j] == TreeMatch::SPLIT) {
+                    links << k << ' ' << m.matchB[j] << ' ' << j << ' '
+                          << change[m.changeB[j]] << '\n';
+                    ++count;
+                }
+        }
+        std::cout << "Scale " << k << " (sigma " << space.sigma(k) << "): "
+                  << tree.nodes().size() << " level lines, " << count
+                  << " links to next." << std::endl;
+        print_stats(tree);
+        valid = check_tree(tree, rowStep) && valid;
+    }
+    links.close();
+    return links? 0: -1;
+}
+
+/// Overwrite the output image with each successive tree. Tiles or distance
+/// field, if any, are written for the final tree only.
+struct PreviewSink : public ProgressSink {
+    size_t w, h;
+    int z;
+    Mode mode;
+    const char* fname;
+    int rowStep; ///< Validation of final tree if strictly positive
+    int tile; ///< Side of map tiles, 0 for a single image
+    std::string field; ///< Types of lines of distance field, if not empty
+    int err; ///< Nonzero if any write failed
+    bool valid;
+    PreviewSink(size_t w0, size_t h0, int zoom, Mode m, const char* f,
+                int step, int t, const std::string& types)
+    : w(w0), h(h0), z(zoom), mode(m), fname(f), rowStep(step), tile(t),
+      field(types), err(0), valid(true) {}
+    void operator()(int scale, LLTree& tree) {
+        std::cout << "Scale " << scale << ": "
+                  << tree.nodes().size() << " level lines" << std::endl;
+        if(tile==0 && field.empty())
+            err |= write_tree(tree, w, h, z, mode, 0, fname);
+        else if(scale == 1)
+            err |= (tile>0)? write_tiles(tree, w, h, z, tile, fname):
+                write_field(tree, w, h, z, field, fname);
+        if(scale == 1) {
+            print_stats(tree);
+            valid = check_tree(tree, rowStep);
+        }
+    }
+};
+
 /// Main procedure for curvature microscope.
 int main(int argc, char** argv) {
     int z=1;
     CmdLine cmd; cmd.prefixDoc = "\t";
     cmd.add( make_option('z',z,"zoom").doc("Zoom factor (integer)") );
+    cmd.add( make_switch('s',"sparse")
+             .doc("Sparse canvas, for mostly background output") );
+    cmd.add( make_switch('a',"antialias")
+             .doc("Anti-aliased output (RGB, ignores -s)") );
+    int coarsest=0;
+    cmd.add( make_option('p',coarsest,"progressive")
+             .doc("Coarse trees first, downsampled by p, p/2..., 2") );
+    int rowStep=0;
+    cmd.add( make_option('c',rowStep,"check")
+             .doc("Validate tree, checking nesting every c rows") );
+    int tile=0;
+    cmd.add( make_option('t',tile,"tiles")
+             .doc("Map tiles of side t, out is a directory of level/x/y.png") );
+    std::string field;
+    cmd.add( make_option('f',field,"field")
+             .doc("Signed distance field to lines of types in f (m: min, "
+                  "M: max, s: saddle), z samples per pixel") );
+    int scales=0;
+    cmd.add( make_option('g',scales,"gaussian")
+             .doc("Trees at g Gaussian scales sqrt(2)^k and their links, "
+                  "out is a prefix") );
+    std::string maskFile;
+    cmd.add( make_option('m',maskFile,"mask")
+             .doc("Mask image, pixels at 0 having no data") );
+    int noData=0;
+    cmd.add( make_option('n',noData,"nodata")
+             .doc("Value of pixels without data") );
     cmd.process(argc, argv);
     if(argc!=3) {
         std::cerr << "Usage: " << argv[0]
@@ -87,49 +612,120 @@ int main(int argc, char** argv) {
         std::cerr << "The zoom factor must be strictly positive" << std::endl;
         return 1;
     }
+    if(tile<0) {
+        std::cerr << "The side of tiles must be positive" << std::endl;
+        return 1;
+    }
+    if(cmd.used('f') && tile>0) {
+        std::cerr << "Options -f and -t are exclusive" << std::endl;
+        return 1;
+    }
+    if(scales<0 || (scales>0 && (coarsest>1 || tile>0 || cmd.used('f')))) {
+        std::cerr << "The number of scales must be positive, and option -g "
+                  << "exclusive of -p, -t and -f" << std::endl;
+        return 1;
+    }
+    if((cmd.used('m') || cmd.used('n')) &&
+       (cmd.used('m')==cmd.used('n') || coarsest>1 || scales>0)) {
+        std::cerr << "Options -m and -n are exclusive, and exclusive of -p "
+                  << "and -g" << std::endl;
+        return 1;
+    }
+    if(cmd.used('n') && (noData<0 || noData>255)) {
+        std::cerr << "The value without data must be in [0,255]" << std::endl;
+        return 1;
+    }
+    if(cmd.used('f') && (field.empty() ||
+                         field.find_first_not_of("msM")!=std::string::npos)) {
+        std::cerr << "Invalid types of level lines: " << field << std::endl;
+        return 1;
+    }
 
+    // Singular points are found while decoding, except for progressive,
+    // scale-space and no-data modes. Pixels without data of value noData are
+    // found before the border is set, whose value may be noData.
+    const bool masked = cmd.used('m') || cmd.used('n');
     size_t w, h;
-    unsigned char* in = io_png_read_u8_gray(argv[1], &w, &h);
+    Singular* sing=0;
+    unsigned char* in = cmd.used('n')? io_png_read_u8_gray(argv[1], &w, &h):
+        ingest(argv[1], w, h, (coarsest>1 || scales>0 || masked)? 0: &sing);
     if(! in) {
         std::cerr << "Error reading as PNG image: " << argv[1] << std::endl;
         return 1;
     }
-    fill_border(in, w, h); // Background gray of output
-
-    // Extract level lines
-    LLTree tree(in, (int)w, (int)h, z-1);
-    free(in);
-    std::cout << tree.nodes().size() << " level lines:" << std::endl;
+    NoData* mask=0;
+    if(cmd.used('n')) {
+        mask = new NoData(in, w, h, (unsigned char)noData);
+        fill_border(in, w, h);
+    }
+    if(cmd.used('m')) {
+        size_t wm, hm;
+        unsigned char* valid = io_png_read_u8_gray(maskFile.c_str(), &wm,&hm);
+        if(!valid || wm!=w || hm!=h) {
+            std::cerr << "Error reading mask of size " << w << 'x' << h
+                      << ": " << maskFile << std::endl;
+            free(valid);
+            free(in);
+            return 1;
+        }
+        mask = new NoData(valid, w, h);
+        free(valid);
+    }
+    if(mask)
+        std::cout << "Data: " << mask->count() << " pixels of " << w*h
+                  << '.' << std::endl;
 
-    // Draw level lines
-    TransformZoom t(z);
-    w *= z;
-    h *= z;
-    color_t* out = new color_t[w*h];
-    const color_t palette[4] = {color_t(0,0,0),   color_t(0,0,255),
-                                color_t(0,255,0), color_t(255,0,0)};
-    int stats[4] = {0};
-    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it) {
-        ++stats[it->ll->type];
-        color_t color = palette[it->ll->type];
-        if(it->ll->type == LevelLine::MIN || it->ll->type == LevelLine::MAX) {
-            if(it->parent && it->parent->ll->type==it->ll->type)
-                color = color_t();
-            fill_curve(it->ll->line,color, out,(int)w,(int)h, t);
-        } else
-            draw_curve(it->ll->line,color, out,(int)w,(int)h, t);
+    Mode mode = cmd.used('a')? ANTIALIAS: cmd.used('s')? SPARSE: DENSE;
+    int err;
+    bool valid;
+    if(scales > 0) {
+        err = write_scales(in, w, h, z, mode, scales, argv[2], rowStep, valid);
+        free(in);
+    } else if(coarsest > 1) { // Progressive extraction
+        PreviewSink sink(w, h, z, mode, argv[2], rowStep, tile, field);
+        extract_progressive(in, w, h, z-1, coarsest, sink);
+        free(in);
+        err = sink.err;
+        valid = sink.valid;
+    } else {
+        // Extract level lines. The canvas is prepared before, outside any
+        // parallel region, so that the stages of extraction can overlap.
+        unsigned char* canvas=0;
+        if(mode == DENSE && tile == 0 && field.empty())
+            canvas = new_canvas(w*z, h*z);
+        std::vector< std::vector<Inter> > inter;
+        LLTree tree(in, (int)w, (int)h, z-1,
+                    (z==1 && tile==0 && field.empty())? &inter: 0, sing, mask);
+        delete sing;
+        delete mask;
+        free(in);
+        std::cout << tree.nodes().size() << " level lines:" << std::endl;
+        LineCrossings* cross = 0;
+        if(z == 1 && tile == 0 && field.empty()) { // Fill from crossings
+            cross = new LineCrossings(inter, tree.nodes());
+            std::vector< std::vector<Inter> >().swap(inter);
+        }
+        // Draw level lines
+        if(tile > 0)
+            err = write_tiles(tree, w, h, z, tile, argv[2]);
+        else if(! field.empty())
+            err = write_field(tree, w, h, z, field, argv[2]);
+        else
+            err = write_tree(tree, w, h, z, mode, cross, argv[2], canvas);
+        delete cross;
+        print_stats(tree);
+        valid = check_tree(tree, rowStep);
     }
-    std::cout <<   "Min: "     << stats[LevelLine::MIN]
-              << ". Max: "     << stats[LevelLine::MAX]
-              << ". Saddles: " << stats[LevelLine::SADDLE]
-              << '.' << std::endl;
 
     // Output image
-    if(io_png_write_u8(argv[2], (unsigned char*)out, (int)w, (int)h, 3)!=0){
+    if(err != 0) {
         std::cerr << "Error writing image file " << argv[2] << std::endl;
         return 1;
     }
-    delete [] out;
+    if(! valid) {
+        std::cerr << "Invalid tree of level lines" << std::endl;
+        return 1;
+    }
 
     return 0;
 }
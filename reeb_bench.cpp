@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file reeb_bench.cpp
+ * @brief Time and hardware counters of each stage of reeb.
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "lltree.h"
+#include "border.h"
+#include "ingest.h"
+#include "singular.h"
+#include "draw_curve.h"
+#include "fill_curve.h"
+#include "perf_counters.h"
+#include "cmdLine.h"
+#include "io_png.h"
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+
+typedef PerfCounters::Event Event;
+static const int NB_EVENTS = PerfCounters::NB_EVENTS;
+
+/// Time and counters of each stage, accumulated over runs.
+/// Counters of the calling thread are summed with those of the other thread
+/// of OpenMP teams of two, which extraction uses to search saddle points
+/// concurrently with extrema. That thread is counted also while it waits for
+/// work, so its spinning adds noise to all stages (OMP_WAIT_POLICY=passive
+/// limits it).
+class Bench {
+public:
+    struct Stage {
+        std::string name;
+        double ms; ///< Wall-clock time (milliseconds)
+        long long count[NB_EVENTS]; ///< Counters, -1 if unavailable
+        size_t points; ///< Number of points of level lines, 0 if irrelevant
+    };
+    std::vector<Stage> stages;
+    PerfCounters counters;
+
+    Bench();
+    ~Bench() { delete helper_; }
+    void start();
+    void restart();
+    Stage& stop(const char* name, size_t points=0);
+    void report(std::ostream& str, int runs) const;
+private:
+    PerfCounters* helper_; ///< Counters of the other thread, if any
+    size_t next_; ///< Index of next stage in current run
+    std::chrono::steady_clock::time_point t0_;
+    long long c0_[NB_EVENTS];
+    void read(long long c[NB_EVENTS]) const;
+    Bench(const Bench&); // Not copyable
+    Bench& operator=(const Bench&);
+};
+
+/// Constructor. The counters of the other thread must be opened from it: with
+/// OpenMP, the same thread joins all teams of two threads.
+Bench::Bench(): helper_(0), next_(0) {
+#ifdef _OPENMP
+#pragma omp parallel num_threads(2)
+    {
+        bool master=false;
+#pragma omp master
+        master = true;
+        if(! master)
+            helper_ = new PerfCounters;
+    }
+#endif
+}
+
+/// Read counters of both threads. A counter is unavailable (-1) if it is so
+/// for the calling thread.
+void Bench::read(long long c[NB_EVENTS]) const {
+    counters.read(c);
+    if(! helper_)
+        return;
+    long long c2[NB_EVENTS];
+    helper_->read(c2);
+    for(int i=0; i<NB_EVENTS; i++)
+        if(c[i] >= 0 && c2[i] >= 0)
+            c[i] += c2[i];
+}
+
+/// Start a new run.
+void Bench::start() {
+    next_ = 0;
+    read(c0_);
+    t0_ = std::chrono::steady_clock::now();
+}
+
+/// Start again current stage, not counting what was done since its start.
+void Bench::restart() {
+    read(c0_);
+    t0_ = std::chrono::steady_clock::now();
+}
+
+/// End the stage started at previous start(), restart() or stop(), and start
+/// next one.
+Bench::Stage& Bench::stop(const char* name, size_t points) {
+    std::chrono::steady_clock::time_point t=std::chrono::steady_clock::now();
+    long long c[NB_EVENTS];
+    read(c);
+    if(next_ == stages.size()) { // First run
+        Stage s;
+        s.name = name;
+        s.ms = 0;
+        for(int i=0; i<NB_EVENTS; i++)
+            s.count[i] = (c[i]<0)? -1: 0;
+        s.points = 0;
+        stages.push_back(s);
+    }
+    Stage& s = stages[next_++];
+    s.ms += std::chrono::duration<double,std::milli>(t-t0_).count();
+    for(int i=0; i<NB_EVENTS; i++)
+        if(s.count[i] >= 0)
+            s.count[i] += c[i]-c0_[i];
+    s.points += points;
+    restart();
+    return s;
+}
+
+/// Print a ratio, or n/a if undefined.
+static void ratio(std::ostream& str, int width, double num, double denom) {
+    str << std::setw(width);
+    if(num < 0 || denom <= 0)
+        str << "n/a";
+    else
+        str << num/denom;
+}
+
+/// Print stage averages over \a runs, then ratios per point of level line.
+void Bench::report(std::ostream& str, int runs) const {
+    const int W=10;
+    str << std::fixed << std::setprecision(2);
+    str << std::left << std::setw(W) << "stage" << std::right
+        << std::setw(W) << "ms";
+    for(int i=0; i<NB_EVENTS; i++)
+        str << std::setw(W) << PerfCounters::name((Event)i);
+    str << std::setw(W) << "IPC" << std::endl;
+    std::vector<Stage>::const_iterator it;
+    for(it=stages.begin(); it!=stages.end(); ++it) {
+        str << std::left << std::setw(W) << it->name << std::right;
+        ratio(str, W, it->ms, runs);
+        for(int i=0; i<NB_EVENTS; i++)
+            ratio(str, W, (double)it->count[i], 1e6*runs); // In millions
+        ratio(str, W, (double)it->count[PerfCounters::INSTRUCTIONS],
+              (double)it->count[PerfCounters::CYCLES]);
+        str << std::endl;
+    }
+    str << "Counters in millions per run." << std::endl << std::endl;
+
+    str << std::left << std::setw(W) << "per point" << std::right
+        << std::setw(W) << "ns";
+    for(int i=0; i<NB_EVENTS; i++)
+        str << std::setw(W) << PerfCounters::name((Event)i);
+    str << std::setw(W) << "points" << std::endl;
+    for(it=stages.begin(); it!=stages.end(); ++it) {
+        if(it->points == 0)
+            continue;
+        double n = (double)it->points;
+        str << std::left << std::setw(W) << it->name << std::right;
+        ratio(str, W, 1e6*it->ms, n);
+        for(int i=0; i<NB_EVENTS; i++)
+            ratio(str, W, (double)it->count[i], n);
+        str << std::setw(W) << it->points/runs << std::endl;
+    }
+    if(! counters.any())
+        str << "Hardware counters unavailable (see perf_event_paranoid)."
+            << std::endl;
+}
+
+/// Store level lines and count their points, ending the extrema stage at
+/// first saddle.
+struct StageSink : public LineSink {
+    Bench& bench;
+    std::vector<LevelLine*> ll;
+    size_t points;
+    bool saddles; ///< Have saddle lines started?
+    StageSink(Bench& b): bench(b), points(0), saddles(false) {}
+    void operator()(size_t, const LevelLine& l) {
+        if(!saddles && l.type==LevelLine::SADDLE) {
+            bench.stop("extrema", points);
+            points = 0;
+            saddles = true;
+        }
+        ll.push_back( new LevelLine(l) );
+        points += l.line.size();
+    }
+};
+
+/// Draw level lines of the tree in \a im, with value the type of each line.
+static void render(LLTree& tree, unsigned char* im, int w, int h, int z) {
+    struct Zoom : public TransformPoint {
+        int z;
+        Zoom(int zoom): z(zoom) {}
+        Point operator()(const Point& p) const { return Point(z*p.x,z*p.y); }
+    } t(z);
+    std::fill(im, im+(size_t)w*h, (unsigned char)LevelLine::REGULAR);
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it) {
+        LevelLine::Type type = it->ll->type;
+        if(type==LevelLine::MIN || type==LevelLine::MAX)
+            fill_curve(it->ll->line, (unsigned char)type, im, w, h, t);
+        else
+            draw_curve(it->ll->line, (unsigned char)type, im, w, h, t);
+    }
+}
+
+/// Run all stages once; encode only if \a out is not null.
+/// Stage saddles includes the search and sort of saddle points, or the end of
+/// it when OpenMP runs it concurrently with the extrema. If \a fused, stage
+/// ingest replaces decode and border, finding singular points while decoding.
+/// Stage tree builds the hierarchy from the lines already extracted.
+/// Return false if an input/output error occurred.
+static bool run(Bench& bench, const char* in, const char* out, int z,
+                bool fused) {
+    static const unsigned char palette[] = {255,255,255,   0,  0,255,
+                                              0,255,  0, 255,  0,  0};
+    bench.start();
+    size_t w, h;
+    unsigned char* im;
+    Singular* sing=0;
+    if(fused) {
+        if(! (im = ingest(in, w, h, &sing)))
+            return false;
+        bench.stop("ingest");
+    } else {
+        if(! (im = io_png_read_u8_gray(in, &w, &h)))
+            return false;
+        bench.stop("decode");
+        fill_border(im, w, h);
+        bench.stop("border");
+    }
+
+    StageSink sink(bench);
+    std::vector< std::vector<Inter> > inter;
+    extract(im, w, h, z-1, sink, &inter, sing);
+    if(! sink.saddles) { // No saddle, end of extrema stage
+        bench.stop("extrema", sink.points);
+        sink.points = 0;
+    }
+    bench.stop("saddles", sink.points);
+
+    std::vector<size_t> parent;
+    LLTree::hierarchy(inter, sink.ll.size(), parent);
+    LLTree tree(sink.ll, parent);
+    Bench::Stage& s = bench.stop("tree");
+    delete sing;
+    free(im);
+    std::vector<LLTree::Node>::const_iterator it=tree.nodes().begin();
+    for(; it!=tree.nodes().end(); ++it)
+        s.points += it->ll->line.size();
+    w *= z;
+    h *= z;
+    im = new unsigned char[w*h];
+    bench.restart(); // Do not count the above
+
+    render(tree, im, (int)w, (int)h, z);
+    bench.stop("render");
+    bool ok = true;
+    if(out) {
+        ok = (io_png_write_u8_palette(out, im, w, h, palette, 4) == 0);
+        bench.stop("encode");
+    }
+    delete [] im;
+    return ok;
+}
+
+/// Main procedure of benchmark.
+int main(int argc, char** argv) {
+    int z=1, runs=1;
+    std::string out;
+    CmdLine cmd; cmd.prefixDoc = "\t";
+    cmd.add( make_option('z',z,"zoom").doc("Zoom factor (integer)") );
+    cmd.add( make_option('r',runs,"runs").doc("Number of runs (average)") );
+    cmd.add( make_option('o',out,"output").doc("Output PNG image (encode)") );
+    cmd.add( make_switch('f',"fused")
+             .doc("Find singular points while decoding") );
+    cmd.process(argc, argv);
+    if(argc!=2) {
+        std::cerr << "Usage: " << argv[0] << " [options] in.png" << std::endl;
+        std::cerr << "Option:\n" << cmd;
+        return 1;
+    }
+    if(z<1 || runs<1) {
+        std::cerr << "Zoom and runs must be strictly positive" << std::endl;
+        return 1;
+    }
+
+    Bench bench;
+    for(int i=0; i<runs; i++)
+        if(! run(bench, argv[1], cmd.used('o')? out.c_str(): 0, z,
+                 cmd.used('f'))) {
+            std::cerr << "Error reading or writing PNG image" << std::endl;
+            return 1;
+        }
+    bench.report(std::cout, runs);
+    return 0;
+}
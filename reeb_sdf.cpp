@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file reeb_sdf.cpp
+ * @brief Render level lines at any zoom from their signed distance field.
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "distance_field.h"
+#include "cmdLine.h"
+#include "io_png.h"
+#include <cstdlib>
+
+/// Main procedure: no extraction, only interpolation of the field written by
+/// reeb -f.
+int main(int argc, char** argv) {
+    int z=1;
+    float width=1;
+    CmdLine cmd; cmd.prefixDoc = "\t";
+    cmd.add( make_option('z',z,"zoom")
+             .doc("Zoom factor from field samples (integer)") );
+    cmd.add( make_option('w',width,"width")
+             .doc("Width of lines in output pixels (1)") );
+    cmd.add( make_switch('i',"inside")
+             .doc("Gray inside an odd number of lines") );
+    cmd.process(argc, argv);
+    if(argc!=3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [options] field.png out.png" << std::endl;
+        std::cerr << "Option:\n" << cmd;
+        return 1;
+    }
+    if(z<1 || width<=0) {
+        std::cerr << "Zoom and width must be strictly positive" << std::endl;
+        return 1;
+    }
+
+    size_t w, h;
+    unsigned char* field = io_png_read_u8_gray(argv[1], &w, &h);
+    if(! field) {
+        std::cerr << "Error reading as PNG image: " << argv[1] << std::endl;
+        return 1;
+    }
+    if(w<2 || h<2) {
+        std::cerr << "The field must have at least 2x2 samples" << std::endl;
+        free(field);
+        return 1;
+    }
+    static const unsigned char palette[] = {  0,  0,  0, // FieldPixel
+                                            192,192,192,
+                                            255,255,255};
+    unsigned char* out = new unsigned char[w*z*h*z];
+    render_field(field, w, h, z, width, cmd.used('i'), out);
+    free(field);
+    int err = io_png_write_u8_palette(argv[2], out, w*z, h*z,
+                                      palette, sizeof(palette)/3);
+    delete [] out;
+    if(err != 0) {
+        std::cerr << "Error writing PNG image: " << argv[2] << std::endl;
+        return 1;
+    }
+    return 0;
+}
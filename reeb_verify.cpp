@@ -0,0 +1,1025 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file reeb_verify.cpp
+ * @brief Differential verification of engines of extraction and rendering.
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "lltree.h"
+#include "border.h"
+#include "draw_curve.h"
+#include "fill_curve.h"
+#include "progressive.h"
+#include "attribute_filter.h"
+#include "label_map.h"
+#include "tree_match.h"
+#include "nodata.h"
+#include "validate.h"
+#include "shape_descriptors.h"
+#include "bilinear.h"
+#include "cmdLine.h"
+#include "io_png.h"
+#include <algorithm>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+
+/// Canonical output of an engine, comparable exactly with another one.
+struct Result {
+    std::vector<LevelLine> lines; ///< Sorted, each closed line rotated
+    std::vector<int> parent; ///< Index in lines, -1 for roots. Empty: no tree
+    std::vector<unsigned char> render; ///< Empty if no rendering
+};
+
+/// Order of lines in a Result.
+static bool less_line(const LevelLine* l1, const LevelLine* l2) {
+    if(l1->type != l2->type)
+        return (l1->type < l2->type);
+    if(l1->level != l2->level)
+        return (l1->level < l2->level);
+    if(l1->line.size() != l2->line.size())
+        return (l1->line.size() < l2->line.size());
+    for(size_t i=0; i<l1->line.size(); i++) {
+        const Point &p=l1->line[i], &q=l2->line[i];
+        if(p != q)
+            return (p.y<q.y || (p.y==q.y && p.x<q.x));
+    }
+    return false;
+}
+
+/// Rotate closed line to start at its smallest point (by y then x).
+static void rotate(std::vector<Point>& line) {
+    if(line.size()<2 || line.front()!=line.back())
+        return;
+    line.pop_back();
+    std::vector<Point>::iterator m=line.begin();
+    for(std::vector<Point>::iterator it=line.begin(); it!=line.end(); ++it)
+        if(it->y<m->y || (it->y==m->y && it->x<m->x))
+            m = it;
+    std::rotate(line.begin(), m, line.end());
+    line.push_back(line.front());
+}
+
+/// Order of indices of lines.
+struct LessIndex {
+    const std::vector<LevelLine*>& ll;
+    LessIndex(const std::vector<LevelLine*>& l): ll(l) {}
+    bool operator()(size_t i, size_t j) const {
+        return less_line(ll[i], ll[j]);
+    }
+};
+
+/// Fill \a r with canonical form of lines \a ll, whose parents are given by
+/// index in ll (if \a parent is not null). Lines are rotated in place.
+static void canonical(const std::vector<LevelLine*>& ll,
+                      const std::vector<int>* parent, Result& r) {
+    const size_t n = ll.size();
+    std::vector<size_t> sorted(n);
+    for(size_t i=0; i<n; i++) {
+        rotate(ll[i]->line);
+        sorted[i] = i;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), LessIndex(ll));
+    r.lines.clear();
+    r.lines.reserve(n);
+    std::vector<int> rank(n);
+    for(size_t i=0; i<n; i++) {
+        r.lines.push_back(*ll[sorted[i]]);
+        rank[sorted[i]] = (int)i;
+    }
+    r.parent.clear();
+    if(parent) {
+        r.parent.resize(n);
+        for(size_t i=0; i<n; i++)
+            r.parent[rank[i]] = ((*parent)[i]<0)? -1: rank[(*parent)[i]];
+    }
+}
+
+struct TransformZoom : public TransformPoint {
+    int z;
+    TransformZoom(int zoom=1): z(zoom) {}
+    Point operator()(const Point& p) const {
+        return Point(z*p.x, z*p.y);
+    }
+};
+
+/// Value of node in rendering, as in reeb: type of level line, except nested
+/// extrema of same type, which get background value 4.
+static unsigned char value(const LLTree::Node& n) {
+    LevelLine::Type t = n.ll->type;
+    bool filled = (t==LevelLine::MIN || t==LevelLine::MAX);
+    if(filled && n.parent && n.parent->ll->type==t)
+        return 4;
+    return (unsigned char)t;
+}
+
+/// Render the tree in canvas \a c, filling extrema from the crossings if
+/// given, from the polylines otherwise.
+template <class Canvas>
+static void render(LLTree& tree, Canvas& c, int z,
+                   const LineCrossings* cross=0) {
+    TransformZoom t(z);
+    const LLTree::Node* base = tree.nodes().empty()? 0: &tree.nodes()[0];
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it) {
+        LevelLine::Type type = it->ll->type;
+        if(type==LevelLine::MIN || type==LevelLine::MAX) {
+            if(cross)
+                cross->fill(&*it-base, it->ll->line, value(*it), c);
+            else
+                fill_curve(it->ll->line, value(*it), c, t);
+        } else
+            draw_curve(it->ll->line, value(*it), c, t);
+    }
+}
+
+/// Canonical form of tree, without rendering.
+static void canonical(LLTree& tree, Result& r) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    std::vector<LevelLine*> ll;
+    std::vector<int> parent;
+    for(size_t i=0; i<nodes.size(); i++) {
+        ll.push_back(nodes[i].ll);
+        parent.push_back(nodes[i].parent? (int)(nodes[i].parent-&nodes[0]):-1);
+    }
+    canonical(ll, &parent, r);
+}
+
+/// Extraction and rendering of image \a im with zoom factor \a z.
+typedef void (*EngineFn)(const unsigned char* im, size_t w, size_t h, int z,
+                         Result& r);
+
+/// Check of a computation on the tree of image \a im, with \a z-1 points
+/// per pixel, against a brute-force one. Return the first difference, empty
+/// if none.
+typedef std::string (*CheckFn)(const unsigned char* im, size_t w, size_t h,
+                               int z);
+
+/// Reference engine: tree, then rendering of polylines in dense canvas.
+static void engine_reference(const unsigned char* im, size_t w, size_t h,
+                             int z, Result& r) {
+    LLTree tree(im, w, h, z-1);
+    r.render.assign(w*z*h*z, 4);
+    DenseCanvas<unsigned char> c(&r.render[0], (int)w*z, (int)h*z);
+    render(tree, c, z);
+    canonical(tree, r);
+}
+
+/// Streaming extraction, lines only.
+static void engine_stream(const unsigned char* im, size_t w, size_t h,
+                          int z, Result& r) {
+    struct Collect : public LineSink {
+        std::vector<LevelLine*> ll;
+        void operator()(size_t, const LevelLine& l) {
+            ll.push_back(new LevelLine(l));
+        }
+    } sink;
+    extract(im, w, h, z-1, sink);
+    canonical(sink.ll, 0, r);
+    for(size_t i=0; i<sink.ll.size(); i++)
+        delete sink.ll[i];
+}
+
+/// Each line of streaming extraction traced again alone, from its first point.
+static void engine_trace(const unsigned char* im, size_t w, size_t h,
+                         int z, Result& r) {
+    struct Trace : public LineSink {
+        const unsigned char* im;
+        size_t w, h;
+        int ptsPixel;
+        std::vector<LevelLine*> ll;
+        void operator()(size_t, const LevelLine& l) {
+            LevelLine* t = new LevelLine(l.level, l.type);
+            const Point& p = l.line.front();
+            if(! trace_line(im, w, h, ptsPixel, p.x, p.y, l.level, *t))
+                t->line.clear();
+            t->type = l.type; // Traced as REGULAR
+            ll.push_back(t);
+        }
+    } sink;
+    sink.im = im; sink.w = w; sink.h = h; sink.ptsPixel = z-1;
+    extract(im, w, h, z-1, sink);
+    canonical(sink.ll, 0, r);
+    for(size_t i=0; i<sink.ll.size(); i++)
+        delete sink.ll[i];
+}
+
+/// Extrema filled from the row crossings of the extraction (zoom 1 only).
+static void engine_crossings(const unsigned char* im, size_t w, size_t h,
+                             int z, Result& r) {
+    std::vector< std::vector<Inter> > inter;
+    LLTree tree(im, w, h, z-1, (z==1)? &inter: 0);
+    LineCrossings* cross = (z==1)? new LineCrossings(inter,tree.nodes())
+                                 : 0;
+    r.render.assign(w*z*h*z, 4);
+    DenseCanvas<unsigned char> c(&r.render[0], (int)w*z, (int)h*z);
+    render(tree, c, z, cross);
+    delete cross;
+    canonical(tree, r);
+}
+
+/// Tree built from extracted level lines and the parents found from their
+/// crossings with rows.
+static void engine_adopt(const unsigned char* im, size_t w, size_t h,
+                         int z, Result& r) {
+    std::vector<LevelLine*> ll;
+    std::vector< std::vector<Inter> > inter;
+    extract(im, w, h, z-1, ll, &inter);
+    std::vector<size_t> parent;
+    LLTree::hierarchy(inter, ll.size(), parent);
+    LLTree tree(ll, parent);
+    r.render.assign(w*z*h*z, 4);
+    DenseCanvas<unsigned char> c(&r.render[0], (int)w*z, (int)h*z);
+    render(tree, c, z);
+    canonical(tree, r);
+}
+
+/// Extraction with a mask where all pixels have data.
+static void engine_nodata(const unsigned char* im, size_t w, size_t h,
+                          int z, Result& r) {
+    std::vector<unsigned char> valid(w*h, 255);
+    NoData mask(&valid[0], w, h);
+    LLTree tree(im, w, h, z-1, 0, 0, &mask);
+    r.render.assign(w*z*h*z, 4);
+    DenseCanvas<unsigned char> c(&r.render[0], (int)w*z, (int)h*z);
+    render(tree, c, z);
+    canonical(tree, r);
+}
+
+/// Rendering in sparse canvas.
+static void engine_sparse(const unsigned char* im, size_t w, size_t h,
+                          int z, Result& r) {
+    LLTree tree(im, w, h, z-1);
+    SpanCanvas<unsigned char> c((int)w*z, (int)h*z, 4);
+    render(tree, c, z);
+    r.render.resize(w*z*h*z);
+    for(int y=0; y<c.height(); y++)
+        c.row(y, &r.render[y*w*z]);
+    canonical(tree, r);
+}
+
+/// Exact tree of progressive extraction.
+static void engine_progressive(const unsigned char* im, size_t w, size_t h,
+                               int z, Result& r) {
+    struct Final : public ProgressSink {
+        Result& r;
+        Final(Result& res): r(res) {}
+        void operator()(int scale, LLTree& tree) {
+            if(scale == 1)
+                canonical(tree, r);
+        }
+    } sink(r);
+    extract_progressive(im, w, h, z-1, 4, sink);
+}
+
+/// Innermost node of each pixel plus one, 0 if none: all lines filled by
+/// fill_curve in pre-order, in an image of dimensions \a w x \a h.
+static void paint_labels(LLTree& tree, size_t w, size_t h,
+                         std::vector<unsigned int>& label) {
+    label.assign(w*h, 0);
+    DenseCanvas<unsigned int> c(&label[0], (int)w, (int)h);
+    const LLTree::Node* base = tree.nodes().empty()? 0: &tree.nodes()[0];
+    for(LLTree::iterator it=tree.begin(); it!=tree.end(); ++it)
+        fill_curve(it->ll->line, (unsigned int)(&*it-base+1), c);
+}
+
+/// Collect the filtered images of an attribute profile.
+struct CollectProfile : public ProfileSink {
+    std::vector< std::vector<unsigned char> > images;
+    CollectProfile(size_t k): images(k) {}
+    void operator()(size_t k, double, const unsigned char* im,
+                    size_t w, size_t h) {
+        images[k].assign(im, im+w*h); // Distinct k in concurrent calls
+    }
+};
+
+/// Attribute profile, compared to filtering each pixel separately: it takes
+/// the level of the outermost node containing it whose attribute is below the
+/// threshold, if any.
+static std::string check_profile(const unsigned char* im, size_t w, size_t h,
+                                 int z) {
+    LLTree tree(im, w, h, z-1);
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    std::vector<unsigned int> label;
+    paint_labels(tree, w, h, label);
+    const Attribute attrs[] = {AREA, PERSISTENCE};
+    const double thresholds[2][4] = {{100, 1, 1000, 10}, {5, 1, 60, 20}};
+    for(int a=0; a<2; a++) {
+        std::vector<double> attr;
+        compute_attribute(tree, attrs[a], attr);
+        std::vector<double> t(thresholds[a], thresholds[a]+4);
+        CollectProfile sink(t.size());
+        attribute_profile(tree, im, w, h, attr, t, sink);
+        for(size_t k=0; k<t.size(); k++)
+            for(size_t i=0; i<w*h; i++) {
+                const LLTree::Node* removed=0;
+                const LLTree::Node* n = label[i]? &nodes[label[i]-1]: 0;
+                for(; n; n=n->parent)
+                    if(attr[n-&nodes[0]] < t[k])
+                        removed = n;
+                unsigned char v = removed?
+                    (unsigned char)(short)(removed->ll->level+0.5f): im[i];
+                if(sink.images[k][i] != v) {
+                    std::ostringstream str;
+                    str << "attribute " << a << " threshold " << t[k]
+                        << " at pixel (" << i%w << ',' << i/w << "): "
+                        << (int)v << " vs " << (int)sink.images[k][i];
+                    return str.str();
+                }
+            }
+    }
+    return std::string();
+}
+
+/// Integral over the polygon \a line of (x-cx)^p (y-cy)^q, up to sign, by
+/// Green's theorem: sum over edges of the integral of (x-cx)^(p+1)/(p+1)
+/// (y-cy)^q dy, evaluated by Gauss-Legendre quadrature with 3 points, exact
+/// for these polynomials of degree p+q+1<=5.
+static double moment(const std::vector<Point>& line, int p, int q,
+                     double cx, double cy) {
+    static const double t[3] = {0.5-0.5*std::sqrt(0.6), 0.5,
+                                0.5+0.5*std::sqrt(0.6)};
+    static const double g[3] = {5/18.0, 8/18.0, 5/18.0};
+    double m=0;
+    for(size_t i=0; i<line.size(); i++) {
+        const Point &a=line[i], &b=line[(i+1)%line.size()];
+        double dx=(double)b.x-a.x, dy=(double)b.y-a.y;
+        for(int k=0; k<3; k++) {
+            double x=a.x+t[k]*dx-cx, y=a.y+t[k]*dy-cy;
+            m += g[k]*std::pow(x,p+1)/(p+1)*std::pow(y,q)*dy;
+        }
+    }
+    return m;
+}
+
+/// Are \a a and \a b equal up to relative tolerance \a eps?
+static bool near(double a, double b, double eps) {
+    return std::abs(a-b) <= eps*std::max(1.0, std::max(std::abs(a),
+                                                       std::abs(b)));
+}
+
+/// Shape descriptors, compared to moments integrated edge by edge around the
+/// centroid. Normalized moments and invariants are compared for areas of at
+/// least one pixel only, below which they are ill-conditioned.
+static std::string check_shapes(const unsigned char* im, size_t w, size_t h,
+                                int z) {
+    LLTree tree(im, w, h, z-1);
+    ShapeTable t;
+    shape_descriptors(tree, t);
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    for(size_t i=0; i<nodes.size(); i++) {
+        const std::vector<Point>& line = nodes[i].ll->line;
+        double a = moment(line, 0, 0, 0, 0);
+        double s = (a<0)? -1: +1;
+        a *= s;
+        if(a == 0)
+            continue;
+        double cx = s*moment(line, 1, 0, 0, 0)/a;
+        double cy = s*moment(line, 0, 1, 0, 0)/a;
+        double mu[4][4];
+        for(int p=0; p<=3; p++)
+            for(int q=0; p+q<=3; q++)
+                mu[p][q] = s*moment(line, p, q, cx, cy);
+        double a2=a*a, n3=a2*std::sqrt(a);
+        double expected[] = {a, cx, cy,
+            mu[2][0]/a2, mu[1][1]/a2, mu[0][2]/a2,
+            mu[3][0]/n3, mu[2][1]/n3, mu[1][2]/n3, mu[0][3]/n3,
+            (mu[2][0]*mu[0][2]-mu[1][1]*mu[1][1])/(a2*a2),
+            (mu[3][0]*mu[3][0]*mu[0][3]*mu[0][3]
+             - 6*mu[3][0]*mu[2][1]*mu[1][2]*mu[0][3]
+             + 4*mu[3][0]*std::pow(mu[1][2],3)
+             + 4*std::pow(mu[2][1],3)*mu[0][3]
+             - 3*mu[2][1]*mu[2][1]*mu[1][2]*mu[1][2])/std::pow(a,10),
+            (mu[2][0]*(mu[2][1]*mu[0][3]-mu[1][2]*mu[1][2])
+             - mu[1][1]*(mu[3][0]*mu[0][3]-mu[2][1]*mu[1][2])
+             + mu[0][2]*(mu[3][0]*mu[1][2]-mu[2][1]*mu[2][1]))/std::pow(a,7)};
+        const double got[] = {t.area[i], t.cx[i], t.cy[i],
+                              t.eta20[i], t.eta11[i], t.eta02[i],
+                              t.eta30[i], t.eta21[i], t.eta12[i], t.eta03[i],
+                              t.I1[i], t.I2[i], t.I3[i]};
+        static const char* names[] = {"area", "cx", "cy",
+                                      "eta20", "eta11", "eta02",
+                                      "eta30", "eta21", "eta12", "eta03",
+                                      "I1", "I2", "I3"};
+        const int nb = (a>=1)? 13: 3;
+        for(int k=0; k<nb; k++)
+            if(! near(expected[k], got[k], 1e-6)) {
+                std::ostringstream str;
+                str << names[k] << " of line " << i << " (area " << a
+                    << "): " << expected[k] << " vs " << got[k];
+                return str.str();
+            }
+    }
+    return std::string();
+}
+
+/// Mean contrast of level lines, compared to sampling the image point by point
+/// on both sides of each distinct vertex of the closed polygon.
+static std::string check_contrast(const unsigned char* im, size_t w, size_t h,
+                                  int z) {
+    LLTree tree(im, w, h, z-1);
+    std::vector<double> contrast;
+    const pt_t dist=0.5f;
+    mean_contrast(tree, im, w, h, contrast, dist);
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    for(size_t i=0; i<nodes.size(); i++) {
+        std::vector<Point> v = nodes[i].ll->line;
+        double expected=0;
+        if(v.size() >= 3) {
+            v.pop_back(); // Closing vertex
+            const size_t n=v.size();
+            for(size_t j=0; j<n; j++) {
+                const Point &p=v[(j+n-1)%n], &q=v[(j+1)%n];
+                pt_t tx=q.x-p.x, ty=q.y-p.y, l=std::sqrt(tx*tx+ty*ty);
+                if(l>0) { tx *= dist/l; ty *= dist/l; }
+                expected += std::abs(
+                    bilinear(im,w,h, Point(v[j].x-ty,v[j].y+tx)) -
+                    bilinear(im,w,h, Point(v[j].x+ty,v[j].y-tx)));
+            }
+            expected /= n;
+        }
+        if(! near(expected, contrast[i], 1e-5)) {
+            std::ostringstream str;
+            str << "contrast of line " << i << " (" << v.size()
+                << " vertices): " << expected << " vs " << contrast[i];
+            return str.str();
+        }
+    }
+    return std::string();
+}
+
+/// Label map, compared to filling all lines in pre-order with fill_curve.
+static std::string check_label_map(const unsigned char* im, size_t w,
+                                   size_t h, int z) {
+    LLTree tree(im, w, h, z-1);
+    std::vector<unsigned int> label, ref;
+    label_map(tree, w, h, label);
+    paint_labels(tree, w, h, ref);
+    for(size_t i=0; i<w*h; i++)
+        if(label[i] != ref[i]) {
+            std::ostringstream str;
+            str << "label at pixel (" << i%w << ',' << i/w << "): " << ref[i]
+                << " vs " << label[i];
+            return str.str();
+        }
+    return std::string();
+}
+
+/// Region masks of \a tree in an image of dimensions \a w x \a h, compared
+/// to pre-order filling with fill_curve: the interior of a node has the pixels
+/// whose innermost node is in its subtree, its ring those whose innermost node
+/// is itself. The query mask is a checkerboard.
+static std::string compare_regions(LLTree& tree, size_t w, size_t h) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const size_t n = nodes.size();
+    std::vector<unsigned int> label;
+    paint_labels(tree, w, h, label);
+    std::vector<RunMask> masks(n);
+    std::vector<size_t> ring(n, 0), inter(n, 0);
+    RunMask q;
+    for(size_t i=0; i<w*h; i++) {
+        int x=(int)(i%w), y=(int)(i/w);
+        bool inQ = ((x/5+y/3)%2 == 0);
+        if(inQ) {
+            Run r = {y, x, x+1};
+            if(!q.empty() && q.back().y==y && q.back().x1==x)
+                ++q.back().x1;
+            else
+                q.push_back(r);
+        }
+        if(label[i])
+            ++ring[label[i]-1];
+        for(LLTree::Node* p=label[i]? &nodes[label[i]-1]: 0; p; p=p->parent) {
+            RunMask& m = masks[p-&nodes[0]];
+            Run r = {y, x, x+1};
+            if(!m.empty() && m.back().y==y && m.back().x1==x)
+                ++m.back().x1;
+            else
+                m.push_back(r);
+            if(inQ)
+                ++inter[p-&nodes[0]];
+        }
+    }
+    RegionMasks R(tree, w, h);
+    RunMask m;
+    for(size_t i=0; i<n; i++) {
+        std::ostringstream str;
+        R.mask(nodes[i], m);
+        if(R.area(nodes[i]) != area(masks[i]))
+            str << "area " << area(masks[i]) << " vs " << R.area(nodes[i]);
+        else if(R.ring_area(nodes[i]) != ring[i])
+            str << "ring area " << ring[i] << " vs " << R.ring_area(nodes[i]);
+        else if(m.size() != masks[i].size())
+            str << "mask of " << masks[i].size() << " runs vs " << m.size();
+        else if(R.intersection_area(nodes[i], q) != inter[i])
+            str << "intersection area " << inter[i] << " vs "
+                << R.intersection_area(nodes[i], q);
+        for(size_t k=0; str.str().empty() && k<m.size(); k++)
+            if(m[k].y!=masks[i][k].y || m[k].x0!=masks[i][k].x0 ||
+               m[k].x1!=masks[i][k].x1)
+                str << "mask run " << k << " of row " << masks[i][k].y;
+        if(! str.str().empty())
+            return "line " + std::to_string(i) + ": " + str.str();
+    }
+    return std::string();
+}
+
+/// Region masks in the image, then in its top half only, where the lines of
+/// the bottom half have empty masks.
+static std::string check_regions(const unsigned char* im, size_t w, size_t h,
+                                 int z) {
+    LLTree tree(im, w, h, z-1);
+    std::string diff = compare_regions(tree, w, h);
+    if(diff.empty() && (diff=compare_regions(tree, w, h/2)).size())
+        diff = "top half, " + diff;
+    return diff;
+}
+
+/// Best node of Y for each node x of X by exhaustive search, with the rules of
+/// match_trees. The overlap of x and y is \a overlap[x*sx+y*sy].
+static void brute_best(const std::vector<LLTree::Node>& X,
+                       const std::vector<LLTree::Node>& Y,
+                       const std::vector<size_t>& areaX,
+                       const std::vector<size_t>& areaY,
+                       const std::vector<size_t>& overlap, size_t sx,
+                       size_t sy, double tau, std::vector<size_t>& best) {
+    best.assign(X.size(), TreeMatch::NONE);
+    for(size_t x=0; x<X.size(); x++) {
+        if(areaX[x] == 0)
+            continue;
+        double bestScore=0;
+        pt_t bestDiff=0;
+        for(size_t y=0; y<Y.size(); y++) { // Increasing y: first among ties
+            double s = overlap[x*sx+y*sy]/(double)std::max(areaX[x],areaY[y]);
+            pt_t d = std::abs(Y[y].ll->level - X[x].ll->level);
+            if(s>=tau && (s>bestScore || (s==bestScore && d<bestDiff))) {
+                bestScore = s;
+                bestDiff = d;
+                best[x] = y;
+            }
+        }
+    }
+}
+
+/// Matched nodes of the trees of an image and of the image shifted by one
+/// column, compared to mutual best nodes found by exhaustive search. The
+/// overlap of all pairs of nodes is counted from the ancestors of the
+/// innermost nodes of each pixel. Images are cropped to 48x48.
+static std::string check_match(const unsigned char* im, size_t w, size_t h,
+                               int z) {
+    const double tau=0.5;
+    const size_t w2=std::min(w,(size_t)48), h2=std::min(h,(size_t)48);
+    std::vector<unsigned char> a(w2*h2), b(w2*h2);
+    for(size_t y=0; y<h2; y++)
+        for(size_t x=0; x<w2; x++) {
+            a[y*w2+x] = im[y*w+x];
+            b[y*w2+x] = im[y*w+(x? x-1: 0)];
+        }
+    fill_border(&a[0], w2, h2);
+    fill_border(&b[0], w2, h2);
+    LLTree A(&a[0], w2, h2, z-1), B(&b[0], w2, h2, z-1);
+    RegionMasks masksA(A, w2, h2), masksB(B, w2, h2);
+    TreeMatch match;
+    match_trees(A, masksA, B, masksB, match, tau);
+
+    std::vector<LLTree::Node> &nodesA=A.nodes(), &nodesB=B.nodes();
+    const size_t nA=nodesA.size(), nB=nodesB.size();
+    std::vector<unsigned int> labelA, labelB;
+    paint_labels(A, w2, h2, labelA);
+    paint_labels(B, w2, h2, labelB);
+    std::vector<size_t> areaA(nA,0), areaB(nB,0), overlap(nA*nB,0);
+    for(size_t i=0; i<w2*h2; i++) {
+        LLTree::Node* pb0 = labelB[i]? &nodesB[labelB[i]-1]: 0;
+        for(LLTree::Node* pb=pb0; pb; pb=pb->parent)
+            ++areaB[pb-&nodesB[0]];
+        for(LLTree::Node* pa=labelA[i]? &nodesA[labelA[i]-1]: 0; pa;
+            pa=pa->parent) {
+            size_t ia = pa-&nodesA[0];
+            ++areaA[ia];
+            for(LLTree::Node* pb=pb0; pb; pb=pb->parent)
+                ++overlap[ia*nB+(pb-&nodesB[0])];
+        }
+    }
+    std::vector<size_t> bestA, bestB;
+    brute_best(nodesA, nodesB, areaA, areaB, overlap, nB, 1, tau, bestA);
+    brute_best(nodesB, nodesA, areaB, areaA, overlap, 1, nB, tau, bestB);
+    std::ostringstream str;
+    for(size_t ia=0; ia<nA && str.str().empty(); ia++) {
+        size_t ib = bestA[ia];
+        bool same = (ib!=TreeMatch::NONE && bestB[ib]==ia);
+        if(same != (match.changeA[ia]==TreeMatch::SAME) ||
+           (same && match.matchA[ia]!=ib))
+            str << "line " << ia << " of A matched to " << (same? (int)ib: -1)
+                << " vs " << (match.changeA[ia]==TreeMatch::SAME?
+                              (int)match.matchA[ia]: -1);
+    }
+    for(size_t ib=0; ib<nB && str.str().empty(); ib++) {
+        size_t ia = bestB[ib];
+        bool same = (ia!=TreeMatch::NONE && bestA[ia]==ib);
+        if(same != (match.changeB[ib]==TreeMatch::SAME))
+            str << "line " << ib << " of B matched to " << (same? (int)ia: -1)
+                << " vs " << (match.changeB[ib]==TreeMatch::SAME?
+                              (int)match.matchB[ib]: -1);
+    }
+    return str.str();
+}
+
+/// Invalid parents given to the constructor of a tree from level lines: wrong
+/// size, index out of range, self-parent and cycle through a root. Each one
+/// must be rejected, the lines staying with the caller.
+static std::string check_forest(const unsigned char* im, size_t w, size_t h,
+                                int z) {
+    std::vector<LevelLine*> ll;
+    std::vector< std::vector<Inter> > inter;
+    extract(im, w, h, z-1, ll, &inter);
+    std::vector<size_t> parent;
+    LLTree::hierarchy(inter, ll.size(), parent);
+    const size_t n=ll.size();
+    std::vector< std::vector<size_t> > bad(4, parent);
+    bad[0].push_back(LLTree::NO_PARENT);
+    if(n > 0) {
+        bad[1][0] = n;
+        bad[2][0] = 0;
+    }
+    for(size_t i=0; i<n; i++)
+        if(parent[i] != LLTree::NO_PARENT) {
+            size_t r=parent[i];
+            while(parent[r] != LLTree::NO_PARENT)
+                r = parent[r];
+            bad[3][r] = i;
+            break;
+        }
+    std::ostringstream str;
+    for(size_t k=0; k<bad.size() && str.str().empty(); k++) {
+        if(bad[k] == parent)
+            continue;
+        try {
+            LLTree tree(ll, bad[k]);
+            str << "invalid parents " << k << " accepted";
+        } catch(const std::string&) {
+            if(ll.size() != n)
+                str << "lines taken by rejected parents " << k;
+        }
+    }
+    if(str.str().empty())
+        LLTree tree(ll, parent);
+    return str.str();
+}
+
+/// Pseudo-random generator (LCG), deterministic across platforms.
+static unsigned int rnd(unsigned int& seed) {
+    seed = seed*1103515245u + 12345u;
+    return (seed>>16) & 0x7fff;
+}
+
+/// Extraction with pixels without data: a disk at the center and isolated
+/// pixels. The tree must be valid, each point of a line must have its nearest
+/// data points valid, and the crossings with rows must give back the tree and
+/// the fill from the polylines.
+static std::string check_masked(const unsigned char* im, size_t w, size_t h,
+                                int z) {
+    std::vector<unsigned char> valid(w*h);
+    unsigned int seed = (unsigned int)(w*h);
+    const double r = std::min(w,h)/5.0;
+    for(size_t i=0; i<w*h; i++) {
+        double dx=(double)(i%w)-w/2.0, dy=(double)(i/w)-h/2.0;
+        valid[i] = (dx*dx+dy*dy<r*r || rnd(seed)%32==0)? 0: 255;
+    }
+    NoData mask(&valid[0], w, h);
+    std::vector< std::vector<Inter> > inter;
+    LLTree tree(im, w, h, z-1, (z==1)? &inter: 0, 0, &mask);
+    std::ostringstream str;
+    Validation v = validate_tree(tree, 1);
+    if(! v.ok()) {
+        str << v;
+        return str.str();
+    }
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    for(size_t i=0; i<nodes.size(); i++) {
+        const std::vector<Point>& line = nodes[i].ll->line;
+        for(size_t j=0; j<line.size(); j++) {
+            size_t x0=(size_t)std::floor(line[j].x),
+                   x1=(size_t)std::ceil(line[j].x);
+            size_t y0=(size_t)std::floor(line[j].y),
+                   y1=(size_t)std::ceil(line[j].y);
+            if(!valid[y0*w+x0] || !valid[y0*w+x1] ||
+               !valid[y1*w+x0] || !valid[y1*w+x1]) {
+                str << "point (" << line[j].x << ',' << line[j].y
+                    << ") of line " << i << " next to pixel without data";
+                return str.str();
+            }
+        }
+    }
+    if(z == 1) {
+        std::vector<size_t> parent;
+        LLTree::hierarchy(inter, nodes.size(), parent);
+        for(size_t i=0; i<nodes.size(); i++)
+            if(parent[i] != (nodes[i].parent? nodes[i].parent-&nodes[0]:
+                             LLTree::NO_PARENT)) {
+                str << "parent of line " << i << " from crossings";
+                return str.str();
+            }
+        LineCrossings cross(inter, nodes);
+        std::vector<unsigned char> r1(w*h,4), r2(w*h,4);
+        DenseCanvas<unsigned char> c1(&r1[0],(int)w,(int)h),
+            c2(&r2[0],(int)w,(int)h);
+        render(tree, c1, z);
+        render(tree, c2, z, &cross);
+        for(size_t i=0; i<w*h; i++)
+            if(r1[i] != r2[i]) {
+                str << "fill from crossings at pixel (" << i%w << ',' << i/w
+                    << "): " << (int)r1[i] << " vs " << (int)r2[i];
+                return str.str();
+            }
+    }
+    return std::string();
+}
+
+/// A candidate engine, compared to engine_reference, or a check.
+struct Engine {
+    const char* name;
+    EngineFn run; ///< Null for a check
+    CheckFn test; ///< Null for an engine
+};
+
+/// Candidate engines, compared to engine_reference, and checks.
+static const Engine engines[] = {
+    {"stream", engine_stream, 0},
+    {"trace", engine_trace, 0},
+    {"crossings", engine_crossings, 0},
+    {"adopt", engine_adopt, 0},
+    {"sparse", engine_sparse, 0},
+    {"nodata", engine_nodata, 0},
+    {"progressive", engine_progressive, 0},
+    {"profile", 0, check_profile},
+    {"shapes", 0, check_shapes},
+    {"contrast", 0, check_contrast},
+    {"label_map", 0, check_label_map},
+    {"regions", 0, check_regions},
+    {"match", 0, check_match},
+    {"forest", 0, check_forest},
+    {"masked", 0, check_masked}
+};
+
+/// Description of first difference between \a ref and \a r, empty if none.
+/// Only the data present in both are compared.
+static std::string compare(const Result& ref, const Result& r, size_t w) {
+    std::ostringstream str;
+    if(ref.lines.size() != r.lines.size()) {
+        str << "number of lines " << ref.lines.size() <<" vs "<<r.lines.size();
+        return str.str();
+    }
+    for(size_t i=0; i<ref.lines.size(); i++) {
+        const LevelLine &l1=ref.lines[i], &l2=r.lines[i];
+        if(l1.type!=l2.type || l1.level!=l2.level || l1.line!=l2.line) {
+            str << "line " << i << " (level " << l1.level << ", type "
+                << l1.type << ", " << l1.line.size() << " points) vs (level "
+                << l2.level << ", type " << l2.type << ", "
+                << l2.line.size() << " points)";
+            return str.str();
+        }
+    }
+    if(!ref.parent.empty() && !r.parent.empty())
+        for(size_t i=0; i<ref.parent.size(); i++)
+            if(ref.parent[i] != r.parent[i]) {
+                str << "parent of line " << i << ": " << ref.parent[i]
+                    << " vs " << r.parent[i];
+                return str.str();
+            }
+    if(!ref.render.empty() && !r.render.empty())
+        for(size_t i=0; i<ref.render.size(); i++)
+            if(ref.render[i] != r.render[i]) {
+                str << "rendering at pixel (" << i%w << ',' << i/w << "): "
+                    << (int)ref.render[i] << " vs " << (int)r.render[i];
+                return str.str();
+            }
+    return str.str();
+}
+
+/// Compare engine \a e to reference on image \a im, whose border is constant,
+/// or run check \a e on it.
+static std::string check(const Engine& e,
+                         const unsigned char* im, size_t w, size_t h, int z) {
+    if(e.test)
+        return e.test(im, w, h, z);
+    Result ref, r;
+    engine_reference(im, w, h, z, ref);
+    e.run(im, w, h, z, r);
+    return compare(ref, r, w*z);
+}
+
+/// Subimage [x0,x1)x[y0,y1) of \a im, with constant border.
+static std::vector<unsigned char> crop(const std::vector<unsigned char>& im,
+                                       size_t w,
+                                       size_t x0, size_t y0,
+                                       size_t x1, size_t y1) {
+    std::vector<unsigned char> out;
+    out.reserve((x1-x0)*(y1-y0));
+    for(size_t y=y0; y<y1; y++)
+        out.insert(out.end(), im.begin()+y*w+x0, im.begin()+y*w+x1);
+    fill_border(&out[0], x1-x0, y1-y0);
+    return out;
+}
+
+/// Reduce \a im to a smallest crop where engine \a e still disagrees with
+/// the reference, or check \a e still fails: sides are moved inward by
+/// decreasing steps as long as the mismatch remains.
+static void shrink(const Engine& e, std::vector<unsigned char>& im,
+                   size_t& w, size_t& h, int z) {
+    for(size_t step=std::max(w,h)/2; step>=1; step/=2) {
+        bool progress=true;
+        while(progress) {
+            progress = false;
+            for(int side=0; side<4; side++) {
+                size_t x0=0, y0=0, x1=w, y1=h;
+                size_t& s = (side==0)? x0: (side==1)? y0: (side==2)? x1: y1;
+                if((side%2==0? w: h) < step+3)
+                    continue;
+                s = (side<2)? s+step: s-step;
+                std::vector<unsigned char> sub = crop(im, w, x0, y0, x1, y1);
+                if(! check(e, &sub[0], x1-x0, y1-y0, z).empty()) {
+                    im.swap(sub);
+                    w = x1-x0;
+                    h = y1-y0;
+                    progress = true;
+                }
+            }
+        }
+    }
+}
+
+/// Image of the corpus.
+struct Image {
+    std::string name;
+    std::vector<unsigned char> data;
+    size_t w, h;
+};
+
+/// Synthetic images: noise at several scales, gradients, waves, plateaus and
+/// checkerboards, which stress ties of levels and saddles, and images taller
+/// than 256 rows.
+static void synthetic(std::vector<Image>& corpus) {
+    const char* names[] = {"noise", "noise_coarse", "gradient", "wave",
+                           "plateaus", "checker", "strip_tall", "noise_tall"};
+    // Rows beyond 256 have coordinates of reduced float precision
+    const size_t W[] = {61, 69, 77, 85, 93, 101, 3, 67};
+    const size_t H[] = {47, 51, 55, 59, 63, 67, 259, 300};
+    unsigned int seed = 1;
+    for(int k=0; k<8; k++) {
+        Image im;
+        im.name = names[k];
+        im.w = W[k];
+        im.h = H[k];
+        im.data.resize(im.w*im.h);
+        std::vector<unsigned char> coarse(64*64);
+        for(size_t i=0; i<coarse.size(); i++)
+            coarse[i] = (unsigned char)(rnd(seed)&0xff);
+        for(size_t y=0; y<im.h; y++)
+            for(size_t x=0; x<im.w; x++) {
+                double v=0;
+                switch(k) {
+                case 0: case 6: case 7: v = rnd(seed)&0xff; break;
+                case 1: v = coarse[(y/4)*64+x/4]; break;
+                case 2: v = 2.0*x+1.5*y; break;
+                case 3: v = 128+100*std::sin(x*0.3)*std::cos(y*0.25); break;
+                case 4: v = 32*(coarse[(y/6)*64+x/6]/64); break;
+                case 5: v = ((x/3+y/3)%2)? 200: 50; break;
+                }
+                im.data[y*im.w+x] = (unsigned char)std::min(255.0, v);
+            }
+        fill_border(&im.data[0], im.w, im.h);
+        corpus.push_back(im);
+    }
+}
+
+/// Value of an RGB pixel output by reeb: black, blue, green and red for the
+/// types of level lines, white for background as in value(); -1 otherwise.
+static int golden_value(const unsigned char* rgb) {
+    static const unsigned char colors[5][3] = {{0,0,0}, {0,0,255}, {0,255,0},
+                                               {255,0,0}, {255,255,255}};
+    for(int i=0; i<5; i++)
+        if(std::equal(rgb, rgb+3, colors[i]))
+            return i;
+    return -1;
+}
+
+/// Compare the rendering of engine_reference with a golden output of reeb
+/// from the baseline, stored as PNG file \a fname. Description of first
+/// difference, empty if none.
+static std::string check_golden(const Image& im, int z,
+                                const std::string& fname) {
+    std::ostringstream str;
+    size_t w, h;
+    unsigned char* rgb = io_png_read_u8_rgb(fname.c_str(), &w, &h);
+    if(! rgb)
+        return "missing golden output " + fname;
+    Result ref;
+    engine_reference(&im.data[0], im.w, im.h, z, ref);
+    if(w != im.w*z || h != im.h*z)
+        str << "golden size " << w << 'x' << h;
+    for(size_t i=0; str.str().empty() && i<w*h; i++) {
+        int v = golden_value(rgb+3*i);
+        if(v != (int)ref.render[i])
+            str << "golden rendering at pixel (" << i%w << ',' << i/w
+                << "): " << (int)ref.render[i] << " vs " << v;
+    }
+    free(rgb);
+    return str.str();
+}
+
+/// Name of golden output of image \a name at zoom \a z in directory \a dir.
+static std::string golden_name(const std::string& dir, std::string name,
+                               int z) {
+    std::string::size_type i = name.rfind('/');
+    if(i != std::string::npos)
+        name.erase(0, i+1);
+    i = name.rfind(".png");
+    if(i != std::string::npos && i+4 == name.size())
+        name.erase(i);
+    std::ostringstream str;
+    str << dir << '/' << name << "_z" << z << ".png";
+    return str.str();
+}
+
+/// Main procedure of verification.
+int main(int argc, char** argv) {
+    int z=1;
+    std::string prefix="repro_", golden;
+    CmdLine cmd; cmd.prefixDoc = "\t";
+    cmd.add( make_option('z',z,"zoom").doc("Zoom factor (integer)") );
+    cmd.add( make_option('o',prefix,"output")
+             .doc("Prefix of reproducer images (default repro_)") );
+    cmd.add( make_option('g',golden,"golden")
+             .doc("Compare reference with baseline outputs in directory g, "
+                  "as name_z<zoom>.png") );
+    cmd.process(argc, argv);
+    if(z<1) {
+        std::cerr << "The zoom factor must be strictly positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<Image> corpus;
+    for(int i=1; i<argc; i++) {
+        Image im;
+        im.name = argv[i];
+        unsigned char* data = io_png_read_u8_gray(argv[i], &im.w, &im.h);
+        if(! data) {
+            std::cerr << "Error reading as PNG image: " << argv[i] << std::endl;
+            return 1;
+        }
+        fill_border(data, im.w, im.h);
+        im.data.assign(data, data+im.w*im.h);
+        free(data);
+        corpus.push_back(im);
+    }
+    synthetic(corpus);
+
+    const int nEngines = (int)(sizeof(engines)/sizeof(*engines));
+    const int nJobs = nEngines*(int)corpus.size();
+    std::vector<std::string> report(nJobs);
+    int failures=0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(+:failures)
+#endif
+    for(int j=0; j<nJobs; j++) {
+        const Engine& e = engines[j%nEngines];
+        const Image& im = corpus[j/nEngines];
+        std::string diff = check(e, &im.data[0], im.w, im.h, z);
+        std::ostringstream str;
+        str << e.name << ' ' << im.name << ": ";
+        if(diff.empty())
+            str << "OK";
+        else {
+            ++failures;
+            std::vector<unsigned char> sub(im.data);
+            size_t w=im.w, h=im.h;
+            shrink(e, sub, w, h, z);
+            std::ostringstream fname;
+            fname << prefix << e.name << '_' << j/nEngines << ".png";
+            str << "MISMATCH " << diff << "\n\treproducer " << fname.str()
+                << " (" << w << 'x' << h << "): "
+                << check(e, &sub[0], w, h, z);
+            if(io_png_write_u8(fname.str().c_str(), &sub[0], w, h, 1) != 0)
+                str << "\n\terror writing reproducer";
+        }
+        report[j] = str.str();
+    }
+    for(int j=0; j<nJobs; j++)
+        std::cout << report[j] << std::endl;
+    int nComparisons = nJobs;
+    if(! golden.empty())
+        for(size_t i=0; i<corpus.size(); i++, nComparisons++) {
+            std::string fname = golden_name(golden, corpus[i].name, z);
+            std::string diff = check_golden(corpus[i], z, fname);
+            std::cout << "golden " << corpus[i].name << ": ";
+            if(diff.empty())
+                std::cout << "OK" << std::endl;
+            else {
+                ++failures;
+                std::cout << "MISMATCH " << diff << std::endl;
+            }
+        }
+    std::cout << failures << " mismatch(es) in " << nComparisons
+              << " comparisons" << std::endl;
+    return (failures==0)? 0: 1;
+}
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file scale_space.cpp
+ * @brief Trees of level lines of an image at several Gaussian scales
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "scale_space.h"
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+/// Half of the sampled Gaussian kernel of standard deviation \a sigma>0,
+/// normalized, from its center to 3 sigma, so at least two elements.
+static void kernel(double sigma, std::vector<float>& g) {
+    assert(sigma > 0);
+    const int r = (int)std::ceil(3*sigma);
+    g.resize(r+1);
+    double sum=0;
+    for(int k=0; k<=r; k++) {
+        g[k] = (float)std::exp(-k*k/(2*sigma*sigma));
+        sum += (k==0)? g[k]: 2*g[k];
+    }
+    for(int k=0; k<=r; k++)
+        g[k] = (float)(g[k]/sum);
+}
+
+/// Gaussian smoothing of \a im by separable convolution, with replicated
+/// borders. \a tmp is a buffer of the same size. Both passes accumulate the
+/// contributions of the kernel over whole rows, loops that vectorize.
+/// \a sigma must be positive.
+static void smooth(float* im, float* tmp, size_t w, size_t h, double sigma) {
+    std::vector<float> g;
+    kernel(sigma, g);
+    const int r = (int)g.size()-1;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<float> pad(w+2*r);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for(int y=0; y<(int)h; y++) { // Rows: im -> tmp
+            const float* in = im+(size_t)y*w;
+            float* out = tmp+(size_t)y*w;
+            std::fill(pad.begin(), pad.begin()+r, in[0]);
+            std::copy(in, in+w, pad.begin()+r);
+            std::fill(pad.begin()+r+w, pad.end(), in[w-1]);
+            const float* c = &pad[r];
+            for(size_t x=0; x<w; x++)
+                out[x] = g[0]*c[x];
+            for(int k=1; k<=r; k++) {
+                const float gk=g[k], *a=c-k, *b=c+k;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                for(size_t x=0; x<w; x++)
+                    out[x] += gk*(a[x]+b[x]);
+            }
+        }
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for(int y=0; y<(int)h; y++) { // Columns: tmp -> im
+            float* out = im+(size_t)y*w;
+            const float* c = tmp+(size_t)y*w;
+            for(size_t x=0; x<w; x++)
+                out[x] = g[0]*c[x];
+            for(int k=1; k<=r; k++) {
+                const float gk = g[k];
+                const float* a = tmp+(size_t)std::max(y-k,0)*w;
+                const float* b = tmp+(size_t)std::min(y+k,(int)h-1)*w;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                for(size_t x=0; x<w; x++)
+                    out[x] += gk*(a[x]+b[x]);
+            }
+        }
+    }
+}
+
+/// Smooth image by Gaussian kernels of increasing standard deviations.
+/// \param data,w,h the image, its border being constant.
+/// \param sigmas the standard deviations, non-decreasing, 0 for no smoothing.
+/// \param[out] stack the smoothed images, quantized, one per sigma.
+/// Each image is smoothed from the previous one by the kernel of variance
+/// the difference of variances, smaller than the one from the original image.
+/// The border of the results is reset to the one of \a data, as required by
+/// the extraction.
+void gaussian_stack(const unsigned char* data, size_t w, size_t h,
+                    const std::vector<double>& sigmas,
+                    std::vector< std::vector<unsigned char> >& stack) {
+    std::vector<float> im(data, data+w*h), tmp(w*h);
+    stack.resize(sigmas.size());
+    double prev=0;
+    for(size_t k=0; k<sigmas.size(); k++) {
+        if(sigmas[k] > prev) {
+            smooth(&im[0], &tmp[0], w, h,
+                   std::sqrt(sigmas[k]*sigmas[k]-prev*prev));
+            prev = sigmas[k];
+        }
+        std::vector<unsigned char>& out = stack[k];
+        out.resize(w*h);
+        for(size_t i=0; i<w*h; i++)
+            out[i] = (unsigned char)std::min(255.0f,
+                                             std::max(0.0f, im[i]+0.5f));
+        const unsigned char b = data[0];
+        std::fill(out.begin(), out.begin()+w, b);
+        std::fill(out.end()-w, out.end(), b);
+        for(size_t y=0; y<h; y++)
+            out[y*w] = out[y*w+w-1] = b;
+    }
+}
+
+/// Constructor.
+/// \param data,w,h the image, its border being constant.
+/// \param ptsPixel number of points of discretization per pixel.
+/// \param sigmas the Gaussian scales, non-decreasing.
+/// \param tau the threshold of match_trees for links.
+/// The smoothed images are computed in cascade, then the trees and their
+/// region masks are extracted in parallel over scales, each image being
+/// released as soon as its tree is built. The trees are appended in order of
+/// scale. Adjacent trees are then matched in parallel.
+ScaleSpace::ScaleSpace(const unsigned char* data, size_t w, size_t h,
+                       int ptsPixel, const std::vector<double>& sigmas,
+                       double tau)
+: sigmas_(sigmas), links_(sigmas.empty()? 0: sigmas.size()-1) {
+    std::vector< std::vector<unsigned char> > stack;
+    gaussian_stack(data, w, h, sigmas, stack);
+    const int n = (int)sigmas.size();
+    std::vector<RegionMasks*> masks(n, 0);
+    trees_.reserve(n);
+#ifdef _OPENMP
+#pragma omp parallel for ordered schedule(dynamic)
+#endif
+    for(int k=0; k<n; k++) {
+        LLTree tree(&stack[k][0], w, h, ptsPixel);
+        std::vector<unsigned char>().swap(stack[k]);
+        masks[k] = new RegionMasks(tree, w, h); // Nodes stay in place
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+        trees_.push_back(std::move(tree));
+    }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for(int k=0; k<n-1; k++)
+        match_trees(trees_[k], *masks[k], trees_[k+1], *masks[k+1],
+                    links_[k], tau);
+    for(int k=0; k<n; k++)
+        delete masks[k];
+}
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file scale_space.h
+ * @brief Trees of level lines of an image at several Gaussian scales
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef SCALE_SPACE_H
+#define SCALE_SPACE_H
+
+#include "tree_match.h"
+
+void gaussian_stack(const unsigned char* data, size_t w, size_t h,
+                    const std::vector<double>& sigmas,
+                    std::vector< std::vector<unsigned char> >& stack);
+
+/// Trees of level lines of an image smoothed at increasing Gaussian scales,
+/// with links between the nodes of trees at adjacent scales. The scales can
+/// be followed from one tree to the next one through the links.
+class ScaleSpace {
+public:
+    ScaleSpace(const unsigned char* data, size_t w, size_t h, int ptsPixel,
+               const std::vector<double>& sigmas, double tau=0.5);
+    size_t size() const { return trees_.size(); } ///< Number of scales
+    double sigma(size_t k) const { return sigmas_[k]; }
+    LLTree& tree(size_t k) { return trees_[k]; }
+    /// Links from nodes of tree k (A) to nodes of tree k+1 (B).
+    const TreeMatch& links(size_t k) const { return links_[k]; }
+    ScaleSpace(const ScaleSpace&) = delete;
+    ScaleSpace& operator=(const ScaleSpace&) = delete;
+private:
+    std::vector<double> sigmas_;
+    std::vector<LLTree> trees_;
+    std::vector<TreeMatch> links_; ///< One less than trees
+};
+
+#endif
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file shape_descriptors.cpp
+ * @brief Moments and affine invariant descriptors of level lines
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "shape_descriptors.h"
+#include <cmath>
+
+/// Set number of rows of the table.
+void ShapeTable::resize(size_t n) {
+    std::vector<double>* cols[] = {&area, &cx, &cy,
+                                   &eta20, &eta11, &eta02,
+                                   &eta30, &eta21, &eta12, &eta03,
+                                   &I1, &I2, &I3};
+    for(size_t i=0; i<sizeof(cols)/sizeof(cols[0]); i++)
+        cols[i]->resize(n);
+}
+
+/// Raw moments up to order 3 of the polygonal region.
+struct Moments {
+    double m00, m10, m01, m20, m11, m02, m30, m21, m12, m03;
+};
+
+/// Moments by Green's theorem, sum over the edges of the polygon. Coordinates
+/// are relative to the first vertex \a o for numerical accuracy.
+static Moments moments(const std::vector<Point>& line, const Point& o) {
+    double m00=0, m10=0, m01=0, m20=0, m11=0, m02=0,
+        m30=0, m21=0, m12=0, m03=0;
+    const int n = (int)line.size();
+    const Point* p = &line[0];
+#ifdef _OPENMP
+#pragma omp simd reduction(+:m00,m10,m01,m20,m11,m02,m30,m21,m12,m03)
+#endif
+    for(int i=0; i<n; i++) {
+        int j = (i+1<n)? i+1: 0;
+        double x0=(double)p[i].x-o.x, y0=(double)p[i].y-o.y,
+               x1=(double)p[j].x-o.x, y1=(double)p[j].y-o.y;
+        double a = x0*y1-x1*y0;
+        m00 += a;
+        m10 += a*(x0+x1);
+        m01 += a*(y0+y1);
+        m20 += a*(x0*x0+x0*x1+x1*x1);
+        m02 += a*(y0*y0+y0*y1+y1*y1);
+        m11 += a*(x0*(2*y0+y1)+x1*(y0+2*y1));
+        m30 += a*(x0+x1)*(x0*x0+x1*x1);
+        m03 += a*(y0+y1)*(y0*y0+y1*y1);
+        m21 += a*(x0*x0*(3*y0+y1)+2*x0*x1*(y0+y1)+x1*x1*(y0+3*y1));
+        m12 += a*(y0*y0*(3*x0+x1)+2*y0*y1*(x0+x1)+y1*y1*(x0+3*x1));
+    }
+    double s = (m00<0)? -1: +1; // Orientation of the polygon
+    Moments m = {s*m00/2,  s*m10/6,  s*m01/6,  s*m20/12, s*m11/24, s*m02/12,
+                 s*m30/20, s*m21/60, s*m12/60, s*m03/20};
+    return m;
+}
+
+/// Fill row \a i of \a t with descriptors of \a line.
+static void descriptors(const std::vector<Point>& line, ShapeTable& t, size_t i){
+    Point o = line.empty()? Point(0,0): line.front();
+    Moments m = moments(line, o);
+    t.area[i] = m.m00;
+    if(m.m00 == 0) { // Degenerate polygon
+        t.cx[i]=o.x; t.cy[i]=o.y;
+        t.eta20[i]=t.eta11[i]=t.eta02[i]=0;
+        t.eta30[i]=t.eta21[i]=t.eta12[i]=t.eta03[i]=0;
+        t.I1[i]=t.I2[i]=t.I3[i]=0;
+        return;
+    }
+    double x=m.m10/m.m00, y=m.m01/m.m00; // Centroid, relative to o
+    t.cx[i] = o.x+x;
+    t.cy[i] = o.y+y;
+    // Central moments
+    double u20 = m.m20-x*m.m10, u02 = m.m02-y*m.m01, u11 = m.m11-x*m.m01;
+    double u30 = m.m30-3*x*m.m20+2*x*x*m.m10;
+    double u03 = m.m03-3*y*m.m02+2*y*y*m.m01;
+    double u21 = m.m21-2*x*m.m11-y*m.m20+2*x*x*m.m01;
+    double u12 = m.m12-2*y*m.m11-x*m.m02+2*y*y*m.m10;
+    // Normalization by powers of area
+    double a2=m.m00*m.m00, a4=a2*a2, a7=a4*a2*m.m00, a10=a7*a2*m.m00;
+    double n2=a2, n3=a2*std::sqrt(m.m00);
+    t.eta20[i]=u20/n2; t.eta11[i]=u11/n2; t.eta02[i]=u02/n2;
+    t.eta30[i]=u30/n3; t.eta21[i]=u21/n3; t.eta12[i]=u12/n3; t.eta03[i]=u03/n3;
+    t.I1[i] = (u20*u02-u11*u11)/a4;
+    t.I2[i] = (u30*u30*u03*u03 - 6*u30*u21*u12*u03 + 4*u30*u12*u12*u12
+               + 4*u21*u21*u21*u03 - 3*u21*u21*u12*u12)/a10;
+    t.I3[i] = (u20*(u21*u03-u12*u12) - u11*(u30*u03-u21*u12)
+               + u02*(u30*u12-u21*u21))/a7;
+}
+
+/// Compute shape descriptors of the level lines of all nodes of the tree.
+/// \param tree the tree of level lines.
+/// \param[out] table the descriptors, row i for node \c tree.nodes()[i].
+void shape_descriptors(LLTree& tree, ShapeTable& table) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const int n = (int)nodes.size();
+    table.resize(n);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+    for(int i=0; i<n; i++)
+        descriptors(nodes[i].ll->line, table, i);
+}
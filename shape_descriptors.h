@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file shape_descriptors.h
+ * @brief Moments and affine invariant descriptors of level lines
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef SHAPE_DESCRIPTORS_H
+#define SHAPE_DESCRIPTORS_H
+
+#include "lltree.h"
+
+/// Descriptors of all nodes, one column per descriptor, indexed as nodes.
+struct ShapeTable {
+    std::vector<double> area;   ///< Area enclosed by the level line
+    std::vector<double> cx, cy; ///< Centroid
+    /// Normalized central moments of order 2 and 3
+    std::vector<double> eta20, eta11, eta02, eta30, eta21, eta12, eta03;
+    /// Affine moment invariants of Flusser and Suk
+    std::vector<double> I1, I2, I3;
+    void resize(size_t n);
+    size_t size() const { return area.size(); }
+};
+
+void shape_descriptors(LLTree& tree, ShapeTable& table);
+
+#endif
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file singular.cpp
+ * @brief Singular points of the bilinear image: extrema and saddles
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "singular.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+/// Properties of a plateau, gathered at its root.
+enum { BORDER=1, LOWER=2, HIGHER=4 };
+
+/// Constructor, before any row is added.
+Extrema::Extrema(size_t w, size_t h, const NoData* mask)
+: w_(w), h_(h), mask_(mask), y_(0), prev_(0), uf_(w*h), prop_(w*h, 0) {
+    assert(w*h <= (size_t)(unsigned int)-1);
+}
+
+/// Find root of pixel \a i in union-find forest, with path halving.
+unsigned int Extrema::find_root(unsigned int i) {
+    while(uf_[i] != i)
+        i = uf_[i] = uf_[uf_[i]];
+    return i;
+}
+
+/// Merge plateaus of pixels \a i and \a j, with their properties. The root is
+/// the smallest index, so that it is the first pixel of the plateau in raster
+/// order.
+void Extrema::merge(unsigned int i, unsigned int j) {
+    i = find_root(i);
+    j = find_root(j);
+    if(j < i)
+        std::swap(i, j);
+    if(i < j) {
+        uf_[j] = i;
+        prop_[i] |= prop_[j];
+    }
+}
+
+/// Record that pixel \a i, of level \a vi, has a neighbor of level \a vj.
+void Extrema::compare(unsigned int i, unsigned char vi, unsigned char vj) {
+    if(vi != vj)
+        prop_[find_root(i)] |= (vj<vi)? LOWER: HIGHER;
+}
+
+/// Add next row of the image. Only pixels inside the border are labeled, so
+/// that the border can still be modified.
+void Extrema::add_row(const unsigned char* row) {
+    const size_t y = y_++;
+    const unsigned char* prev = prev_;
+    prev_ = row;
+    if(y==0 || y+1>=h_)
+        return;
+    if(mask_) {
+        add_masked_row(y, row, prev);
+        return;
+    }
+    const unsigned int w=(unsigned int)w_, i0=(unsigned int)(y*w_);
+    for(unsigned int x=1; x+1<w; x++) {
+        unsigned int i = i0+x;
+        uf_[i] = i;
+        if(x>=2 && row[x-1]==row[x])
+            merge(i, i-1);
+        if(y>=2 && prev[x]==row[x])
+            merge(i, i-w);
+    }
+    for(unsigned int x=1; x+2<w; x++) {
+        compare(i0+x, row[x], row[x+1]);
+        compare(i0+x+1, row[x+1], row[x]);
+    }
+    if(y>=2)
+        for(unsigned int x=1; x+1<w; x++) {
+            compare(i0+x, row[x], prev[x]);
+            compare(i0+x-w, prev[x], row[x]);
+        }
+}
+
+/// Add row \a y, of which only runs of pixels with data are labeled. A pixel
+/// with a 4-neighbor without data marks its plateau as touching the border.
+void Extrema::add_masked_row(size_t y, const unsigned char* row,
+                             const unsigned char* prev) {
+    const unsigned int w=(unsigned int)w_, i0=(unsigned int)(y*w_);
+    const NoData::Span *first, *last;
+    mask_->pixels(y, first, last);
+    for(const NoData::Span* s=first; s!=last; ++s) {
+        const unsigned int x0=std::max(s->x0,1u), x1=std::min(s->x1,w-1);
+        for(unsigned int x=x0; x<x1; x++) {
+            unsigned int i = i0+x;
+            uf_[i] = i;
+            if(x>x0 && row[x-1]==row[x])
+                merge(i, i-1);
+            if(y>=2 && mask_->pixel(i-w) && prev[x]==row[x])
+                merge(i, i-w);
+        }
+        for(unsigned int x=x0; x+1<x1; x++) {
+            compare(i0+x, row[x], row[x+1]);
+            compare(i0+x+1, row[x+1], row[x]);
+        }
+        for(unsigned int x=x0; x<x1; x++) {
+            unsigned int i = i0+x;
+            if(y>=2 && mask_->pixel(i-w)) {
+                compare(i, row[x], prev[x]);
+                compare(i-w, prev[x], row[x]);
+            }
+            if(!mask_->pixel(i-1) || !mask_->pixel(i+1) ||
+               !mask_->pixel(i-w) || !mask_->pixel(i+w))
+                prop_[find_root(i)] |= BORDER;
+        }
+    }
+}
+
+/// Ranges [i0,i1) of indices of pixels inside the border, with data, in
+/// raster order.
+void Extrema::interior(std::vector< std::pair<unsigned int,unsigned int> >& r)
+    const {
+    const unsigned int w=(unsigned int)w_, h=(unsigned int)h_;
+    for(unsigned int y=1; y+1<h; y++) {
+        if(! mask_) {
+            r.push_back( std::make_pair(y*w+1, (y+1)*w-1) );
+            continue;
+        }
+        const NoData::Span *first, *last;
+        mask_->pixels(y, first, last);
+        for(const NoData::Span* s=first; s!=last; ++s) {
+            const unsigned int x0=std::max(s->x0,1u), x1=std::min(s->x1,w-1);
+            if(x0 < x1)
+                r.push_back( std::make_pair(y*w+x0, y*w+x1) );
+        }
+    }
+}
+
+/// Compare plateaus with their neighbors in the border of \a im, then number
+/// extrema by raster order of their root and gather their seeds.
+void Extrema::complete(const unsigned char* im) {
+    assert(y_ == h_);
+    root.clear();
+    max.clear();
+    first.assign(1, 0);
+    seeds.clear();
+    if(w_<3 || h_<3)
+        return;
+    const unsigned int w=(unsigned int)w_, h=(unsigned int)h_;
+    for(unsigned int k=0; k<2; k++) {
+        unsigned int b = k? (h-1)*w: 0; // Border row
+        unsigned int d = k? (unsigned int)-w: w; // Towards inside
+        for(unsigned int i=b+1; i+1<b+w; i++)
+            if(mask_ && !mask_->pixel(i+d))
+                continue;
+            else if(im[i+d] == im[i])
+                prop_[find_root(i+d)] |= BORDER;
+            else
+                compare(i+d, im[i+d], im[i]);
+    }
+    for(unsigned int y=1; y+1<h; y++)
+        for(unsigned int k=0; k<2; k++) {
+            unsigned int i = y*w + (k? w-1: 0); // Border column
+            unsigned int j = k? i-1: i+1; // Neighbor inside
+            if(mask_ && !mask_->pixel(j))
+                continue;
+            if(im[j] == im[i])
+                prop_[find_root(j)] |= BORDER;
+            else
+                compare(j, im[j], im[i]);
+        }
+
+    const unsigned int NONE = (unsigned int)-1;
+    std::vector<unsigned int> label(w*h, NONE); // Extremum index, at root only
+    std::vector< std::pair<unsigned int,unsigned int> > range;
+    interior(range);
+    std::vector< std::pair<unsigned int,unsigned int> >::const_iterator it;
+    for(it=range.begin(); it!=range.end(); ++it)
+        for(unsigned int i=it->first; i<it->second; i++) {
+            unsigned int r = uf_[i] = find_root(i);
+            if(r==i && (prop_[i]==LOWER || prop_[i]==HIGHER)) {
+                label[i] = (unsigned int)root.size();
+                root.push_back(i);
+                max.push_back(prop_[i]==LOWER);
+            }
+        }
+    first.assign(root.size()+1, 0);
+    for(it=range.begin(); it!=range.end(); ++it)
+        for(unsigned int i=it->first; i<it->second; i++)
+            if(label[uf_[i]]!=NONE && im[i+1]!=im[i])
+                ++first[label[uf_[i]]+1];
+    for(size_t k=0; k<root.size(); k++)
+        first[k+1] += first[k];
+    seeds.resize(first.back());
+    std::vector<unsigned int> pos(first.begin(), first.end()-1);
+    for(it=range.begin(); it!=range.end(); ++it)
+        for(unsigned int i=it->first; i<it->second; i++)
+            if(label[uf_[i]]!=NONE && im[i+1]!=im[i])
+                seeds[pos[label[uf_[i]]]++] = i;
+    std::vector<unsigned int>().swap(uf_);
+    std::vector<unsigned char>().swap(prop_);
+}
+
+bool operator<(const Saddle& s1, const Saddle& s2) {
+    return s1.value < s2.value;
+}
+
+/// Order of saddles by position, in raster order.
+static bool raster_less(const Saddle& s1, const Saddle& s2) {
+    return (s1.y<s2.y || (s1.y==s2.y && s1.x<s2.x));
+}
+
+/// If saddle in unit square of values \a a, \a b (top) and \a c, \a d
+/// (bottom), return its level.
+static bool level_saddle(unsigned char a, unsigned char b,
+                         unsigned char c, unsigned char d, pt_t& v) {
+    unsigned char min=a, max=d;
+    if(min>max)
+        std::swap(min,max);
+    int sb = b<min? -1: b>max? 1: 0;
+    int sc = c<min? -1: c>max? 1: 0;
+    if(sb*sc <= 0)
+        return false;
+    v = (a*d-b*c)/pt_t(a+d-b-c);
+    return true;
+}
+
+/// Constructor, before any row is added.
+Saddles::Saddles(size_t w, size_t h, const NoData* mask)
+: w_(w), h_(h), mask_(mask), y_(0), prev_(0) {}
+
+/// Add next row of the image, examining squares between it and previous row
+/// that do not touch the border.
+void Saddles::add_row(const unsigned char* row) {
+    const size_t y = y_++;
+    const unsigned char* prev = prev_;
+    prev_ = row;
+    if(y<2 || y+1>=h_)
+        return;
+    if(! mask_) {
+        for(size_t x=1; x+2<w_; x++) {
+            pt_t v;
+            if(level_saddle(prev[x],prev[x+1], row[x],row[x+1], v))
+                S.push_back( Saddle(x,y-1,v) );
+        }
+        return;
+    }
+    const NoData::Span *first, *last;
+    mask_->duals(y-1, first, last);
+    for(const NoData::Span* s=first; s!=last; ++s) {
+        const size_t x1 = std::min((size_t)s->x1, w_-2);
+        for(size_t x=std::max((size_t)s->x0,(size_t)1); x<x1; x++) {
+            pt_t v;
+            if(level_saddle(prev[x],prev[x+1], row[x],row[x+1], v))
+                S.push_back( Saddle(x,y-1,v) );
+        }
+    }
+}
+
+/// Examine squares touching the border of \a im, then sort saddles by level.
+/// Saddles are in raster order before sorting, as if found in a single pass.
+void Saddles::complete(const unsigned char* im) {
+    assert(y_ == h_);
+    std::vector<Saddle> B; // Saddles in squares touching the border
+    for(size_t y=0; y+1<h_; y++)
+        for(size_t x=0; x+1<w_; x++) {
+            if(y!=0 && y+2!=h_ && x==1)
+                x = std::max(x, w_-2); // Skip interior squares
+            if(mask_ && !mask_->dual(y*w_+x))
+                continue;
+            const unsigned char* p = im+y*w_+x;
+            pt_t v;
+            if(level_saddle(p[0],p[1], p[w_],p[w_+1], v))
+                B.push_back( Saddle(x,y,v) );
+        }
+    std::vector<Saddle> all;
+    all.reserve(S.size()+B.size());
+    std::merge(S.begin(),S.end(), B.begin(),B.end(), std::back_inserter(all),
+               raster_less);
+    S.swap(all);
+    std::sort(S.begin(), S.end());
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file singular.h
+ * @brief Singular points of the bilinear image: extrema and saddles
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef SINGULAR_H
+#define SINGULAR_H
+
+#include "levelLine.h"
+#include "nodata.h"
+
+/// Regional extrema of the image, with their seeds for extraction.
+/// Each extremum is a plateau (4-connected component of constant level) not
+/// touching the image border, whose neighbors are all lower or all higher.
+/// A seed is a pixel of the plateau whose right neighbor is different: the
+/// horizontal edgel joining them is crossed by a level line of the extremum.
+/// Plateaus inside the border are labeled by union-find as rows are added;
+/// complete() then compares them with the border, which may have changed
+/// meanwhile, and gathers the seeds. With a mask of pixels without data, only
+/// the pixels with data are labeled, and plateaus touching the others are
+/// treated as touching the border.
+class Extrema {
+public:
+    std::vector<unsigned int> root; ///< First pixel of each extremum
+    std::vector<bool> max; ///< Is extremum a maximum (or a minimum)?
+    std::vector<unsigned int> first; ///< Index in seeds, one more at the end
+    std::vector<unsigned int> seeds; ///< Seeds of each extremum, raster order
+
+    Extrema(size_t w, size_t h, const NoData* mask=0);
+    void add_row(const unsigned char* row);
+    void complete(const unsigned char* im);
+private:
+    size_t w_, h_;
+    const NoData* mask_; ///< Pixels without data, if any
+    size_t y_; ///< Index of next row
+    const unsigned char* prev_; ///< Previous row
+    std::vector<unsigned int> uf_; ///< Union-find forest
+    std::vector<unsigned char> prop_; ///< Properties of plateaus, at roots
+    unsigned int find_root(unsigned int i);
+    void merge(unsigned int i, unsigned int j);
+    void compare(unsigned int i, unsigned char vi, unsigned char vj);
+    void add_masked_row(size_t y, const unsigned char* row,
+                        const unsigned char* prev);
+    void interior(std::vector< std::pair<unsigned int,unsigned int> >& r)
+        const;
+};
+
+/// Saddle point inside the image.
+struct Saddle {
+    size_t x, y; ///< Top-left corner of sample square
+    pt_t value; ///< Level of saddle
+    Saddle(size_t x0, size_t y0, pt_t v): x(x0), y(y0), value(v) {}
+};
+bool operator<(const Saddle& s1, const Saddle& s2);
+
+/// Saddle points of the bilinear image, found in squares of two consecutive
+/// rows as rows are added. Squares touching the border are examined by
+/// complete(), once the border is final. With a mask of pixels without data,
+/// only squares whose vertices all have data are examined.
+class Saddles {
+public:
+    std::vector<Saddle> S; ///< Saddle points, sorted by level when complete
+
+    Saddles(size_t w, size_t h, const NoData* mask=0);
+    void add_row(const unsigned char* row);
+    void complete(const unsigned char* im);
+private:
+    size_t w_, h_;
+    const NoData* mask_; ///< Pixels without data, if any
+    size_t y_; ///< Index of next row
+    const unsigned char* prev_; ///< Previous row
+};
+
+/// Extrema and saddles, found in the same pass over rows, for example while
+/// the image is decoded.
+struct Singular {
+    Extrema extrema;
+    Saddles saddles;
+    Singular(size_t w, size_t h, const NoData* mask=0)
+    : extrema(w,h,mask), saddles(w,h,mask) {}
+    /// Add next row of the image. The previous row must still be valid.
+    void add_row(const unsigned char* row) {
+        extrema.add_row(row);
+        saddles.add_row(row);
+    }
+    /// Finish after all rows are added. The border of image \a im may differ
+    /// from the rows that were added, but not its interior.
+    void complete(const unsigned char* im) {
+        extrema.complete(im);
+        saddles.complete(im);
+    }
+};
+
+#endif
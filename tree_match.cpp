@@ -0,0 +1,553 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file tree_match.cpp
+ * @brief Correspondence of nodes of two trees of level lines
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "tree_match.h"
+#include <algorithm>
+#include <cmath>
+
+const size_t TreeMatch::NONE;
+
+/// Bounding box of a level line.
+struct Box {
+    pt_t x0, y0, x1, y1;
+    bool intersects(const Box& b) const {
+        return (x0<=b.x1 && b.x0<=x1 && y0<=b.y1 && b.y0<=y1);
+    }
+};
+
+/// Bounding boxes of level lines of nodes, in parallel.
+static void boxes(LLTree& tree, std::vector<Box>& box) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const int n = (int)nodes.size();
+    box.resize(n);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+    for(int i=0; i<n; i++) {
+        const std::vector<Point>& line = nodes[i].ll->line;
+        Box b = {0, 0, -1, -1}; // Empty
+        if(! line.empty()) {
+            b.x0 = b.x1 = line.front().x;
+            b.y0 = b.y1 = line.front().y;
+        }
+        std::vector<Point>::const_iterator it=line.begin();
+        for(; it!=line.end(); ++it) {
+            b.x0 = std::min(b.x0, it->x); b.x1 = std::max(b.x1, it->x);
+            b.y0 = std::min(b.y0, it->y); b.y1 = std::max(b.y1, it->y);
+        }
+        box[i] = b;
+    }
+}
+
+/// Spatial index of boxes in a hierarchy of grids. Level l has square cells of
+/// side CELL*2^l, and a box is stored at the lowest level whose cell side is
+/// at least its own largest side, in the cell of its top-left corner. A box
+/// intersecting a query has its corner in the query extended by one cell.
+class BoxGrid {
+public:
+    static const int CELL=8; ///< Side of cells of level 0
+    BoxGrid(const std::vector<Box>& box, const std::vector<size_t>& area);
+    void query(const Box& q, size_t minArea, size_t maxArea,
+               std::vector<size_t>& out) const;
+private:
+    struct Level {
+        pt_t side;
+        int nx, ny;
+        size_t cell0; ///< Index of first cell
+    };
+    const std::vector<Box>& box_;
+    const std::vector<size_t>& area_;
+    pt_t x0_, y0_; ///< Origin of grids
+    std::vector<Level> levels_;
+    std::vector<size_t> start_; ///< First index in nodes_ of each cell
+    std::vector<unsigned int> nodes_; ///< Indices of boxes, by cell
+    int level(const Box& b) const;
+    size_t cell(const Box& b, int l) const;
+};
+
+/// Constructor, for nodes of pixel area \a area. Empty nodes are not stored.
+BoxGrid::BoxGrid(const std::vector<Box>& box, const std::vector<size_t>& area)
+: box_(box), area_(area), x0_(0), y0_(0) {
+    pt_t x1=0, y1=0;
+    bool first=true;
+    for(size_t i=0; i<box.size(); i++)
+        if(area[i]) {
+            if(first) {
+                x0_ = box[i].x0; y0_ = box[i].y0;
+                x1 = box[i].x1; y1 = box[i].y1;
+                first = false;
+            }
+            x0_ = std::min(x0_, box[i].x0); y0_ = std::min(y0_, box[i].y0);
+            x1 = std::max(x1, box[i].x1); y1 = std::max(y1, box[i].y1);
+        }
+    size_t cells=0;
+    for(pt_t side=CELL; ; side*=2) {
+        Level L = {side, (int)((x1-x0_)/side)+1, (int)((y1-y0_)/side)+1,
+                   cells};
+        levels_.push_back(L);
+        cells += (size_t)L.nx*L.ny;
+        if(side >= x1-x0_ && side >= y1-y0_)
+            break;
+    }
+    start_.assign(cells+1, 0);
+    for(size_t i=0; i<box.size(); i++)
+        if(area[i])
+            ++start_[cell(box[i],level(box[i]))+1];
+    for(size_t c=0; c<cells; c++)
+        start_[c+1] += start_[c];
+    nodes_.resize(start_.back());
+    std::vector<size_t> pos(start_.begin(), start_.end()-1);
+    for(size_t i=0; i<box.size(); i++)
+        if(area[i])
+            nodes_[pos[cell(box[i],level(box[i]))]++] = (unsigned int)i;
+}
+
+/// Level of storage of box \a b.
+int BoxGrid::level(const Box& b) const {
+    pt_t side = std::max(b.x1-b.x0, b.y1-b.y0);
+    int l=0;
+    while(l+1<(int)levels_.size() && levels_[l].side<side)
+        ++l;
+    return l;
+}
+
+/// Index of cell of box \a b at level \a l.
+size_t BoxGrid::cell(const Box& b, int l) const {
+    const Level& L = levels_[l];
+    int x = std::min(L.nx-1, (int)((b.x0-x0_)/L.side));
+    int y = std::min(L.ny-1, (int)((b.y0-y0_)/L.side));
+    return L.cell0 + (size_t)y*L.nx + x;
+}
+
+/// Append to \a out the nodes whose box intersects \a q and whose area is in
+/// [minArea,maxArea]. Levels whose boxes are too small to reach \a minArea
+/// are skipped.
+void BoxGrid::query(const Box& q, size_t minArea, size_t maxArea,
+                    std::vector<size_t>& out) const {
+    std::vector<Level>::const_iterator L=levels_.begin();
+    for(; L!=levels_.end(); ++L) {
+        if((L->side+1)*(L->side+1) < (pt_t)minArea)
+            continue;
+        int cx0 = std::max(0, (int)std::floor((q.x0-L->side-x0_)/L->side));
+        int cy0 = std::max(0, (int)std::floor((q.y0-L->side-y0_)/L->side));
+        int cx1 = std::min(L->nx-1, (int)std::floor((q.x1-x0_)/L->side));
+        int cy1 = std::min(L->ny-1, (int)std::floor((q.y1-y0_)/L->side));
+        for(int y=cy0; y<=cy1; y++)
+            for(int x=cx0; x<=cx1; x++) {
+                size_t c = L->cell0 + (size_t)y*L->nx + x;
+                for(size_t k=start_[c]; k<start_[c+1]; k++) {
+                    unsigned int i = nodes_[k];
+                    if(minArea<=area_[i] && area_[i]<=maxArea &&
+                       box_[i].intersects(q))
+                        out.push_back(i);
+                }
+            }
+    }
+}
+
+/// Rings of all nodes of a tree, gathered by row and sorted by abscissa.
+struct RingRows {
+    struct Piece {
+        int x0, x1;
+        unsigned int rank; ///< Of the node in pre-order
+    };
+    std::vector<size_t> start; ///< First piece of each row, one more at end
+    std::vector<Piece> pieces;
+    RingRows(LLTree& tree, const RegionMasks& masks);
+    static bool less_x0(const Piece& p1, const Piece& p2) {
+        return (p1.x0 < p2.x0);
+    }
+};
+
+/// Constructor, by counting sort of runs of rings by row.
+RingRows::RingRows(LLTree& tree, const RegionMasks& masks) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    RunMask ring;
+    std::vector< std::pair<int,Piece> > all;
+    all.reserve(masks.runs());
+    int h=0;
+    for(size_t i=0; i<nodes.size(); i++) {
+        masks.ring(nodes[i], ring);
+        Piece p = {0, 0, masks.rank(nodes[i])};
+        for(RunMask::const_iterator it=ring.begin(); it!=ring.end(); ++it) {
+            p.x0 = it->x0;
+            p.x1 = it->x1;
+            all.push_back(std::make_pair(it->y,p));
+            h = std::max(h, it->y+1);
+        }
+    }
+    start.assign(h+1, 0);
+    for(size_t k=0; k<all.size(); k++)
+        ++start[all[k].first+1];
+    for(int y=0; y<h; y++)
+        start[y+1] += start[y];
+    pieces.resize(all.size());
+    std::vector<size_t> pos(start.begin(), start.end()-1);
+    for(size_t k=0; k<all.size(); k++)
+        pieces[pos[all[k].first]++] = all[k].second;
+    for(int y=0; y<h; y++) // Rings are disjoint, x0 order is x1 order
+        std::sort(pieces.begin()+start[y], pieces.begin()+start[y+1],
+                  less_x0);
+}
+
+/// Set of pixels whose innermost nodes are of ranks x and y in two trees.
+struct Cell {
+    unsigned int x, y;
+    unsigned int count; ///< Number of pixels
+};
+static bool operator<(const Cell& c1, const Cell& c2) {
+    return (c1.x<c2.x || (c1.x==c2.x && c1.y<c2.y));
+}
+
+/// Overlay of the rings of trees \a A (ranks x) and \a B (ranks y), by merging
+/// their pieces in each row. Cells with same ranks are gathered.
+static void overlay(const RingRows& A, const RingRows& B,
+                    std::vector<Cell>& cells) {
+    cells.clear();
+    const size_t h = std::min(A.start.size(), B.start.size());
+    for(size_t y=0; y+1<h; y++) {
+        std::vector<RingRows::Piece>::const_iterator
+            i=A.pieces.begin()+A.start[y], ie=A.pieces.begin()+A.start[y+1],
+            j=B.pieces.begin()+B.start[y], je=B.pieces.begin()+B.start[y+1];
+        while(i!=ie && j!=je) {
+            int x0=std::max(i->x0,j->x0), x1=std::min(i->x1,j->x1);
+            if(x0 < x1) {
+                Cell c = {i->rank, j->rank, (unsigned int)(x1-x0)};
+                cells.push_back(c);
+            }
+            if(i->x1 < j->x1) ++i; else ++j;
+        }
+    }
+    std::sort(cells.begin(), cells.end());
+    size_t k=0;
+    for(size_t i=0; i<cells.size(); i++)
+        if(k>0 && cells[k-1].x==cells[i].x && cells[k-1].y==cells[i].y)
+            cells[k-1].count += cells[i].count;
+        else
+            cells[k++] = cells[i];
+    cells.resize(k);
+}
+
+/// Number of pixels of cells in a rectangle of ranks, with a merge-sort tree:
+/// cells sorted by x, and at each level blocks of 2^level cells sorted by y
+/// with cumulated counts. A query takes O(log^2) time.
+/// Each of the 1+ceil(log2 n) levels holds all n cells as pairs (y, count),
+/// so the memory is O(n log n), about 16(1+log2 n) bytes per cell on 64-bit
+/// systems. match_trees keeps two of them, one per direction.
+class CellCount {
+public:
+    CellCount(std::vector<Cell>& cells);
+    size_t count(unsigned int x0, unsigned int x1,
+                 unsigned int y0, unsigned int y1) const;
+    unsigned int quantile(unsigned int x0, unsigned int x1, size_t k,
+                          unsigned int ny) const;
+private:
+    std::vector<unsigned int> x_; ///< Sorted x of cells
+    /// Per level, y of cells and cumulated counts in each block
+    std::vector< std::vector< std::pair<unsigned int,size_t> > > levels_;
+    size_t block(int k, size_t j, unsigned int y0, unsigned int y1) const;
+};
+
+/// Constructor, \a cells being sorted by x.
+CellCount::CellCount(std::vector<Cell>& cells) {
+    typedef std::pair<unsigned int,size_t> YC;
+    const size_t n = cells.size();
+    x_.resize(n);
+    std::vector<YC> cur(n), next;
+    for(size_t i=0; i<n; i++) {
+        x_[i] = cells[i].x;
+        cur[i] = YC(cells[i].y, cells[i].count);
+    }
+    for(size_t size=1; ; size*=2) {
+        std::vector<YC> cum(cur);
+        for(size_t i=0; i<n; i++)
+            if(i%size)
+                cum[i].second += cum[i-1].second;
+        levels_.push_back(cum);
+        if(size >= n)
+            break;
+        next.resize(n);
+        for(size_t b=0; b<n; b+=2*size) {
+            std::vector<YC>::iterator m=cur.begin()+std::min(n,b+size),
+                e=cur.begin()+std::min(n,b+2*size);
+            std::merge(cur.begin()+b, m, m, e, next.begin()+b);
+        }
+        cur.swap(next);
+    }
+}
+
+/// Count of cells of y in [y0,y1) in block \a j of level \a k.
+size_t CellCount::block(int k, size_t j, unsigned int y0, unsigned int y1)
+    const {
+    typedef std::pair<unsigned int,size_t> YC;
+    const std::vector<YC>& L = levels_[k];
+    std::vector<YC>::const_iterator b=L.begin()+(j<<k),
+        e=L.begin()+std::min(L.size(),(j+1)<<k);
+    std::vector<YC>::const_iterator i0=std::lower_bound(b,e,YC(y0,0)),
+        i1=std::lower_bound(i0,e,YC(y1,0));
+    return ((i1==b)? 0: (i1-1)->second) - ((i0==b)? 0: (i0-1)->second);
+}
+
+/// Count of pixels of cells in [x0,x1)x[y0,y1).
+size_t CellCount::count(unsigned int x0, unsigned int x1,
+                        unsigned int y0, unsigned int y1) const {
+    size_t l = std::lower_bound(x_.begin(), x_.end(), x0) - x_.begin();
+    size_t r = std::lower_bound(x_.begin(), x_.end(), x1) - x_.begin();
+    size_t c=0;
+    for(int k=0; l<r; k++, l>>=1, r>>=1) {
+        if(l & 1)
+            c += block(k, l++, y0, y1);
+        if(r & 1)
+            c += block(k, --r, y0, y1);
+    }
+    return c;
+}
+
+/// Smallest y in [0,ny) such that cells in [x0,x1)x[0,y] have more than \a k
+/// pixels, by dichotomy. The count in [x0,x1)x[0,ny) must exceed \a k.
+unsigned int CellCount::quantile(unsigned int x0, unsigned int x1, size_t k,
+                                 unsigned int ny) const {
+    unsigned int lo=0, hi=ny-1;
+    while(lo < hi) {
+        unsigned int m = lo+(hi-lo)/2;
+        if(count(x0, x1, 0, m+1) > k)
+            hi = m;
+        else
+            lo = m+1;
+    }
+    return lo;
+}
+
+/// Everything needed about one tree.
+struct MatchSide {
+    LLTree& tree;
+    const RegionMasks& masks;
+    std::vector<Box> box;
+    std::vector<size_t> area;
+    std::vector<size_t> node; ///< Index of node of each rank
+    /// Ancestor at distance 2^k of each node, NONE above a root
+    std::vector< std::vector<size_t> > up;
+    MatchSide(LLTree& t, const RegionMasks& m);
+};
+
+/// Constructor, computing boxes, areas and ancestors of nodes.
+MatchSide::MatchSide(LLTree& t, const RegionMasks& m): tree(t), masks(m) {
+    const size_t NONE = TreeMatch::NONE;
+    boxes(tree, box);
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    const size_t n = nodes.size();
+    area.resize(n);
+    node.resize(n);
+    up.push_back(std::vector<size_t>(n, NONE));
+    bool deeper = false;
+    for(size_t i=0; i<n; i++) {
+        area[i] = masks.area(nodes[i]);
+        node[masks.rank(nodes[i])] = i;
+        if(nodes[i].parent) {
+            up[0][i] = nodes[i].parent-&nodes[0];
+            deeper = deeper || nodes[i].parent->parent;
+        }
+    }
+    while(deeper) {
+        const std::vector<size_t>& prev = up.back();
+        std::vector<size_t> next(n, NONE);
+        for(size_t i=0; i<n; i++)
+            if(prev[i] != NONE)
+                next[i] = prev[prev[i]];
+        deeper = false;
+        for(size_t i=0; i<n && !deeper; i++)
+            deeper = (next[i]!=NONE && next[next[i]]!=NONE);
+        up.push_back(next);
+    }
+}
+
+/// For each node a of A, find its best node of B, ties broken by closest
+/// level. Candidates come from the spatial index of B, with an area in
+/// [tau,1/tau]*area(a). Their overlap with a is counted in \a overlap, whose
+/// x are ranks in A. Nodes of A are handled in parallel.
+static void best_links(const MatchSide& A, const MatchSide& B,
+                       const CellCount& overlap, double tau,
+                       std::vector<size_t>& best) {
+    std::vector<LLTree::Node>& nodesA = A.tree.nodes();
+    std::vector<LLTree::Node>& nodesB = B.tree.nodes();
+    const int n = (int)nodesA.size();
+    best.assign(n, TreeMatch::NONE);
+    BoxGrid gridB(B.box, B.area);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<size_t> cand;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64)
+#endif
+        for(int a=0; a<n; a++) {
+            const size_t area = A.area[a];
+            if(area == 0)
+                continue;
+            cand.clear();
+            gridB.query(A.box[a], (size_t)std::ceil(tau*area),
+                        (size_t)(area/tau), cand);
+            unsigned int r0 = A.masks.rank(nodesA[a]);
+            unsigned int r1 = A.masks.subtree_end(nodesA[a]);
+            double bestScore=0;
+            pt_t bestDiff=0; // Level difference with best
+            std::vector<size_t>::const_iterator it=cand.begin();
+            for(; it!=cand.end(); ++it) {
+                const LLTree::Node& nb = nodesB[*it];
+                size_t o = overlap.count(r0, r1, B.masks.rank(nb),
+                                         B.masks.subtree_end(nb));
+                double s = o/(double)std::max(area, B.area[*it]);
+                pt_t d = std::abs(nb.ll->level - nodesA[a].ll->level);
+                if(s>=tau && (s>bestScore || (s==bestScore &&
+                              (d<bestDiff || (d==bestDiff && *it<best[a]))))) {
+                    bestScore = s;
+                    bestDiff = d;
+                    best[a] = *it;
+                }
+            }
+        }
+    }
+}
+
+/// Host in B of each node a of A whose change is \a unmatched, the smallest
+/// node of B containing more than a fraction \a tau>=0.5 of a, or NONE.
+/// Such nodes of B form a chain of ancestors, whose range of ranks holds most
+/// pixels of a: it contains their weighted median rank. The host is thus the
+/// lowest ancestor of the node of median rank that contains enough of a, found
+/// by binary lifting. Nodes of A are handled in parallel.
+static void hosts(const MatchSide& A, const MatchSide& B,
+                  const CellCount& overlap, double tau,
+                  const std::vector<unsigned char>& change,
+                  unsigned char unmatched,
+                  std::vector<size_t>& host) {
+    const size_t NONE = TreeMatch::NONE;
+    std::vector<LLTree::Node>& nodesA = A.tree.nodes();
+    std::vector<LLTree::Node>& nodesB = B.tree.nodes();
+    const int n = (int)nodesA.size();
+    const unsigned int nB = (unsigned int)nodesB.size();
+    host.assign(n, NONE);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+    for(int a=0; a<n; a++) {
+        if(change[a]!=unmatched || A.area[a]==0)
+            continue;
+        unsigned int r0 = A.masks.rank(nodesA[a]);
+        unsigned int r1 = A.masks.subtree_end(nodesA[a]);
+        size_t total = overlap.count(r0, r1, 0, nB);
+        const double min = tau*A.area[a];
+        if(total <= min)
+            continue;
+        size_t b = B.node[overlap.quantile(r0, r1, total/2, nB)];
+        for(size_t k=B.up.size(); k-- > 0;) { // Highest b not containing a
+            size_t c = B.up[k][b];
+            if(c==NONE)
+                continue;
+            if(overlap.count(r0, r1, B.masks.rank(nodesB[c]),
+                             B.masks.subtree_end(nodesB[c])) <= min)
+                b = c;
+        }
+        if(overlap.count(r0, r1, B.masks.rank(nodesB[b]),
+                         B.masks.subtree_end(nodesB[b])) <= min)
+            b = B.up[0][b];
+        host[a] = b;
+    }
+}
+
+/// Mark as \a change the nodes of \a X whose maximal unmatched parts in \a Y
+/// (nodes hosted by them) are at least two and cover a fraction \a tau of
+/// them, and the parts themselves, with their link to the whole.
+/// \a freeX and \a freeY are the change values of unmatched nodes.
+static void parts(MatchSide& X, std::vector<size_t>& matchX,
+                  std::vector<unsigned char>& changeX, unsigned char freeX,
+                  MatchSide& Y, std::vector<size_t>& matchY,
+                  std::vector<unsigned char>& changeY, unsigned char freeY,
+                  const std::vector<size_t>& hostY, unsigned char change,
+                  double tau) {
+    std::vector<LLTree::Node>& nodesY = Y.tree.nodes();
+    const size_t NONE = TreeMatch::NONE;
+    std::vector<size_t> count(matchX.size(),0), covered(matchX.size(),0);
+    std::vector<bool> part(nodesY.size(), false);
+    for(size_t y=0; y<nodesY.size(); y++) {
+        size_t x = hostY[y];
+        if(changeY[y]!=freeY || x==NONE || changeX[x]!=freeX)
+            continue;
+        const LLTree::Node* p = nodesY[y].parent;
+        if(p) {
+            size_t ip = p-&nodesY[0];
+            if(changeY[ip]==freeY && hostY[ip]==x)
+                continue; // Not maximal
+        }
+        part[y] = true;
+        ++count[x];
+        covered[x] += Y.area[y];
+    }
+    for(size_t x=0; x<matchX.size(); x++)
+        if(count[x]>=2 && covered[x]>=tau*X.area[x])
+            changeX[x] = change;
+    for(size_t y=0; y<nodesY.size(); y++)
+        if(part[y] && changeX[hostY[y]]==change) {
+            changeY[y] = change;
+            matchY[y] = hostY[y];
+        }
+}
+
+/// Match nodes of trees \a A and \a B.
+/// \param masksA,masksB region masks of the trees, built at same dimensions.
+/// \param[out] match correspondence and changes of nodes.
+/// \param tau threshold of score for a match, and of covered fraction for
+/// split and merge, at least 0.5.
+/// Candidate pairs are pruned by bounding boxes in a spatial index and by area.
+/// Their overlap is counted in the overlay of the innermost nodes of both
+/// trees: a node being a range of pre-order ranks, this is a rectangle query.
+/// The cost is near linear in the number of runs of the masks and of
+/// candidates, in parallel over nodes.
+void match_trees(LLTree& A, const RegionMasks& masksA,
+                 LLTree& B, const RegionMasks& masksB,
+                 TreeMatch& match, double tau) {
+    MatchSide SA(A,masksA), SB(B,masksB);
+    std::vector<Cell> cells;
+    {
+        RingRows rowsA(A,masksA), rowsB(B,masksB);
+        overlay(rowsA, rowsB, cells);
+    }
+    CellCount overlapAB(cells);
+    for(size_t i=0; i<cells.size(); i++)
+        std::swap(cells[i].x, cells[i].y);
+    std::sort(cells.begin(), cells.end());
+    CellCount overlapBA(cells);
+    std::vector<Cell>().swap(cells);
+
+    std::vector<size_t> bestA, bestB;
+    best_links(SA, SB, overlapAB, tau, bestA);
+    best_links(SB, SA, overlapBA, tau, bestB);
+    const size_t nA=bestA.size(), nB=bestB.size();
+    match.matchA.assign(nA, TreeMatch::NONE);
+    match.matchB.assign(nB, TreeMatch::NONE);
+    match.changeA.assign(nA, TreeMatch::VANISHED);
+    match.changeB.assign(nB, TreeMatch::APPEARED);
+    for(size_t a=0; a<nA; a++) {
+        size_t b = bestA[a];
+        if(b!=TreeMatch::NONE && bestB[b]==a) {
+            match.matchA[a] = b;
+            match.matchB[b] = a;
+            match.changeA[a] = match.changeB[b] = TreeMatch::SAME;
+        }
+    }
+
+    std::vector<size_t> hostA, hostB;
+    hosts(SA, SB, overlapAB, tau, match.changeA, TreeMatch::VANISHED, hostA);
+    hosts(SB, SA, overlapBA, tau, match.changeB, TreeMatch::APPEARED, hostB);
+    parts(SA, match.matchA, match.changeA, TreeMatch::VANISHED,
+          SB, match.matchB, match.changeB, TreeMatch::APPEARED,
+          hostB, TreeMatch::SPLIT, tau);
+    parts(SB, match.matchB, match.changeB, TreeMatch::APPEARED,
+          SA, match.matchA, match.changeA, TreeMatch::VANISHED,
+          hostA, TreeMatch::MERGED, tau);
+}
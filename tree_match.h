@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file tree_match.h
+ * @brief Correspondence of nodes of two trees of level lines
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef TREE_MATCH_H
+#define TREE_MATCH_H
+
+#include "label_map.h"
+
+/// Correspondence of nodes of trees A and B, for example of consecutive
+/// frames, indexed as \c nodes() of each tree.
+/// Two nodes correspond if each is the best match of the other, the score of
+/// a pair being the number of pixels inside both divided by the largest area,
+/// at least a threshold tau. An unmatched node of A may be split: at least two
+/// nodes of B, unmatched and not nested, have more than a fraction tau of their
+/// area in it (it is their host, the smallest such node) and together cover
+/// tau of its area. Merge is the symmetric case.
+struct TreeMatch {
+    enum Change {
+        SAME,     ///< Matched node
+        VANISHED, ///< Node of A without correspondent
+        APPEARED, ///< Node of B without correspondent
+        SPLIT,    ///< Node of A split, or part of it in B
+        MERGED    ///< Node of B result of a merge, or part of it in A
+    };
+    static const size_t NONE = (size_t)-1;
+    /// Matched node in other tree, or for a part, the split or merged node.
+    std::vector<size_t> matchA, matchB;
+    std::vector<unsigned char> changeA, changeB; ///< Values of Change
+};
+
+void match_trees(LLTree& A, const RegionMasks& masksA,
+                 LLTree& B, const RegionMasks& masksB,
+                 TreeMatch& match, double tau=0.5);
+
+#endif
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file tree_reduce.cpp
+ * @brief Parallel bottom-up and top-down reductions over a tree of level lines
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifdef TREE_REDUCE_H
+
+#include <stack>
+
+/// Constructor.
+/// \param tree the tree of level lines.
+/// \param grain maximal number of nodes of a subtree handled as a single task.
+/// A subtree is a task if its size is at most \a grain but the one of its
+/// parent is larger. Tasks are disjoint, so they can be processed in parallel.
+inline TreePartition::TreePartition(LLTree& tree, size_t grain) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    if(nodes.empty())
+        return;
+    std::vector<size_t> size(nodes.size(), 0);
+    for(LLTree::iterator it=tree.begin(PostOrder); it!=tree.end(); ++it) {
+        size_t i = &*it-&nodes[0];
+        ++size[i];
+        if(it->parent)
+            size[it->parent-&nodes[0]] += size[i];
+    }
+    std::stack<LLTree::Node*> S;
+    for(LLTree::Node* n=tree.root(); n; n=n->sibling)
+        S.push(n);
+    while(! S.empty()) {
+        LLTree::Node* n = S.top(); S.pop();
+        if(size[n-&nodes[0]] <= grain)
+            tasks.push_back(n);
+        else {
+            spine.push_back(n);
+            for(LLTree::Node* c=n->child; c; c=c->sibling)
+                S.push(c);
+        }
+    }
+}
+
+/// Bottom-up computation at node \a n, whose children are already done.
+template <typename T, class Init, class Merge>
+void reduce_up_node(LLTree::Node* n, LLTree::Node* base, std::vector<T>& v,
+                    Init& init, Merge& merge) {
+    T& val = v[n-base];
+    val = init(*n);
+    for(LLTree::Node* c=n->child; c; c=c->sibling)
+        merge(val, v[c-base]);
+}
+
+/// Bottom-up reduction. Each node value is computed by a single thread and
+/// children are merged in sibling order, so that the result is deterministic,
+/// even for a non-commutative \a merge.
+/// \param tree the tree of level lines.
+/// \param[out] v the values, indexed as \c tree.nodes().
+/// \param init functor T(const LLTree::Node&), the value of the node alone.
+/// \param merge functor void(T& acc, const T& child), aggregates a child.
+template <typename T, class Init, class Merge>
+void reduce_up(LLTree& tree, std::vector<T>& v, Init init, Merge merge) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    v.resize(nodes.size());
+    if(nodes.empty())
+        return;
+    LLTree::Node* base = &nodes[0];
+    TreePartition part(tree);
+    const int n = (int)part.tasks.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for(int i=0; i<n; i++) { // Post-order inside each task
+        LLTree::Node *t=part.tasks[i], *c=t;
+        while(c->child) c=c->child;
+        while(true) {
+            reduce_up_node(c, base, v, init, merge);
+            if(c == t)
+                break;
+            if(c->sibling)
+                for(c=c->sibling; c->child; c=c->child);
+            else
+                c = c->parent;
+        }
+    }
+    std::vector<LLTree::Node*>::reverse_iterator it=part.spine.rbegin();
+    for(; it!=part.spine.rend(); ++it) // Reverse pre-order: children first
+        reduce_up_node(*it, base, v, init, merge);
+}
+
+/// Top-down computation at node \a n, whose parent is already done.
+template <typename T, class Root, class Down>
+void reduce_down_node(LLTree::Node* n, LLTree::Node* base, std::vector<T>& v,
+                      Root& root, Down& down) {
+    v[n-base] = n->parent? down(v[n->parent-base], *n): root(*n);
+}
+
+/// Top-down reduction.
+/// \param tree the tree of level lines.
+/// \param[out] v the values, indexed as \c tree.nodes().
+/// \param root functor T(const LLTree::Node&), value at a node without parent.
+/// \param down functor T(const T& parent, const LLTree::Node&), value at a
+/// node from the one at its parent.
+template <typename T, class Root, class Down>
+void reduce_down(LLTree& tree, std::vector<T>& v, Root root, Down down) {
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    v.resize(nodes.size());
+    if(nodes.empty())
+        return;
+    LLTree::Node* base = &nodes[0];
+    TreePartition part(tree);
+    std::vector<LLTree::Node*>::iterator it=part.spine.begin();
+    for(; it!=part.spine.end(); ++it)
+        reduce_down_node(*it, base, v, root, down);
+    const int n = (int)part.tasks.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for(int i=0; i<n; i++) { // Pre-order inside each task
+        LLTree::Node *t=part.tasks[i], *c=t;
+        while(true) {
+            reduce_down_node(c, base, v, root, down);
+            if(c->child) {
+                c = c->child;
+                continue;
+            }
+            while(c!=t && !c->sibling)
+                c = c->parent;
+            if(c == t)
+                break;
+            c = c->sibling;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file tree_reduce.h
+ * @brief Parallel bottom-up and top-down reductions over a tree of level lines
+ * 
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef TREE_REDUCE_H
+#define TREE_REDUCE_H
+
+#include "lltree.h"
+
+/// Decomposition of the tree in independent subtrees (tasks) of bounded size
+/// and the remaining nodes above them (spine), stored in pre-order.
+struct TreePartition {
+    std::vector<LLTree::Node*> tasks; ///< Roots of independent subtrees
+    std::vector<LLTree::Node*> spine; ///< Nodes not in a task, in pre-order
+    TreePartition(LLTree& tree, size_t grain=1024);
+};
+
+/// Bottom-up: v[n] = init(n), then merge(v[n],v[c]) for each child c.
+template <typename T, class Init, class Merge>
+void reduce_up(LLTree& tree, std::vector<T>& v, Init init, Merge merge);
+
+/// Top-down: v[n] = root(n) if n has no parent, else down(v[parent],n).
+template <typename T, class Root, class Down>
+void reduce_down(LLTree& tree, std::vector<T>& v, Root root, Down down);
+
+// Templates must have their implementation nearby
+#include "tree_reduce.cpp"
+
+#endif
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file validate.cpp
+ * @brief Check invariants of the tree of level lines
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#include "validate.h"
+#include <algorithm>
+#include <cmath>
+
+/// Are all invariants satisfied?
+bool Validation::ok() const {
+    for(int i=0; i<NB_INVARIANTS; i++)
+        if(count[i])
+            return false;
+    return true;
+}
+
+/// Output number of violations of each invariant.
+std::ostream& operator<<(std::ostream& str, const Validation& v) {
+    static const char* names[NB_INVARIANTS] =
+        {"closure", "structure", "types", "nesting"};
+    for(int i=0; i<NB_INVARIANTS; i++) {
+        str << names[i] << ": ";
+        if(v.count[i]==0)
+            str << "OK";
+        else
+            str << v.count[i] << " violation(s), first at level "
+                << v.example[i]->ll->level;
+        str << (i+1<NB_INVARIANTS? ". ": ".");
+    }
+    return str;
+}
+
+/// Record violation of invariant \a inv by node of index \a i, keeping the
+/// violating node of lowest index as example.
+static void violation(Validation& v, Invariant inv, size_t i,
+                      std::vector<size_t>& first) {
+#ifdef _OPENMP
+#pragma omp critical(validate)
+#endif
+    {
+        ++v.count[inv];
+        first[inv] = std::min(first[inv], i);
+    }
+}
+
+/// Check fields of node \a n, whose index is \a i. The length of the chain of
+/// children of \a n is added to \a nChildren.
+static void check_node(const std::vector<LLTree::Node>& nodes, size_t i,
+                       Validation& v, std::vector<size_t>& first,
+                       size_t& nChildren) {
+    const LLTree::Node& n = nodes[i];
+    const std::vector<Point>& line = n.ll->line;
+    if(line.empty() || line.front()!=line.back())
+        violation(v, CLOSURE, i, first);
+
+    const LLTree::Node *begin=&nodes[0], *end=begin+nodes.size();
+    size_t len=0;
+    for(const LLTree::Node* c=n.child; c; c=c->sibling, ++len)
+        if(c<begin || c>=end || c->parent!=&n || len>=nodes.size()) {
+            violation(v, STRUCTURE, i, first);
+            break;
+        }
+    nChildren += len;
+    if(n.parent && (n.parent<begin || n.parent>=end))
+        violation(v, STRUCTURE, i, first);
+
+    LevelLine::Type t = n.ll->type;
+    if(! n.child && t!=LevelLine::MIN && t!=LevelLine::MAX)
+        violation(v, TYPES, i, first);
+    // Inside an extremum line, levels are beyond its level. The inner
+    // boundary of a plateau with holes is a child of same type and level, and
+    // its inside is on the other side.
+    if(t==LevelLine::MIN || t==LevelLine::MAX) {
+        bool up = (t==LevelLine::MAX);
+        if(n.parent && n.parent->ll->type==t && n.parent->ll->level==n.ll->level)
+            up = !up;
+        for(const LLTree::Node* c=n.child; c && len-->0; c=c->sibling)
+            if(c->ll->level!=n.ll->level && up!=(c->ll->level>n.ll->level)) {
+                violation(v, TYPES, i, first);
+                break;
+            }
+    }
+}
+
+/// Crossing of a line with a row.
+struct Crossing {
+    pt_t x;
+    size_t node;
+    bool operator<(const Crossing& c) const { return x<c.x; }
+};
+
+/// Abscissae of crossings of closed \a line with rows, stored in \a cross as
+/// (y, x). Rows are edges of dual pixels, where points of the line are exact,
+/// whatever the sampling of hyperbolas inside dual pixels. Half-open rule: an
+/// edge crosses row y if one end is at or above y and the other below.
+static void row_crossings(const std::vector<Point>& line, int rowStep,
+                          std::vector< std::pair<int,pt_t> >& cross) {
+    for(size_t i=0; i+1<line.size(); i++) {
+        Point p=line[i], q=line[i+1];
+        if(p.y == q.y)
+            continue;
+        if(q.y < p.y)
+            std::swap(p,q);
+        int y = (int)std::ceil(p.y);
+        if(y%rowStep)
+            y += rowStep - ((y%rowStep)+rowStep)%rowStep;
+        for(; (pt_t)y < q.y; y+=rowStep)
+            cross.push_back(std::make_pair(y, p.x+(y-p.y)*(q.x-p.x)/(q.y-p.y)));
+    }
+}
+
+/// Check the nesting of lines along rows: sorted crossings of a row must be
+/// well parenthesized, the line enclosing a line at its entry being its
+/// parent. This detects crossing lines and children out of their parent.
+static void check_rows(std::vector<LLTree::Node>& nodes, int rowStep,
+                       Validation& v, std::vector<size_t>& first) {
+    const int n = (int)nodes.size();
+    std::vector< std::vector< std::pair<int,pt_t> > > cross(n);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+    for(int i=0; i<n; i++)
+        row_crossings(nodes[i].ll->line, rowStep, cross[i]);
+
+    // Counting sort by row
+    int ymin=0, ymax=-1;
+    for(int i=0; i<n; i++)
+        for(size_t j=0; j<cross[i].size(); j++) {
+            int y = cross[i][j].first;
+            if(ymax<ymin)
+                ymin = ymax = y;
+            ymin = std::min(ymin, y);
+            ymax = std::max(ymax, y);
+        }
+    const int nRows = ymax-ymin+1;
+    std::vector<size_t> start(nRows+1, 0);
+    for(int i=0; i<n; i++)
+        for(size_t j=0; j<cross[i].size(); j++)
+            ++start[cross[i][j].first-ymin+1];
+    for(int r=0; r<nRows; r++)
+        start[r+1] += start[r];
+    std::vector<Crossing> rows(start[nRows]);
+    std::vector<size_t> pos(start.begin(), start.end()-1);
+    for(int i=0; i<n; i++) {
+        for(size_t j=0; j<cross[i].size(); j++) {
+            Crossing c = {cross[i][j].second, (size_t)i};
+            rows[pos[cross[i][j].first-ymin]++] = c;
+        }
+        std::vector< std::pair<int,pt_t> >().swap(cross[i]);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for(int r=0; r<nRows; r++) {
+        std::vector<Crossing>::iterator b=rows.begin()+start[r],
+            e=rows.begin()+start[r+1];
+        std::sort(b, e);
+        std::vector<size_t> stack;
+        for(; b!=e; ++b) {
+            if(!stack.empty() && stack.back()==b->node) { // Exit line
+                stack.pop_back();
+                continue;
+            }
+            const LLTree::Node* parent = stack.empty()? 0: &nodes[stack.back()];
+            if(nodes[b->node].parent != parent)
+                violation(v, NESTING, b->node, first);
+            stack.push_back(b->node);
+        }
+        if(! stack.empty())
+            violation(v, NESTING, stack.back(), first);
+    }
+}
+
+/// Check invariants of the tree, in parallel over nodes and rows.
+/// \param tree the tree of level lines.
+/// \param rowStep nesting is checked only on one row every rowStep, for a
+/// cheaper partial check.
+Validation validate_tree(LLTree& tree, int rowStep) {
+    Validation v;
+    std::vector<size_t> first(NB_INVARIANTS, (size_t)-1);
+    std::fill(v.count, v.count+NB_INVARIANTS, 0);
+    std::fill(v.example, v.example+NB_INVARIANTS, (LLTree::Node*)0);
+    std::vector<LLTree::Node>& nodes = tree.nodes();
+    if(nodes.empty())
+        return v;
+
+    // Each node must be once a child or a root
+    size_t nChildren=0;
+    const int n = (int)nodes.size();
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:nChildren)
+#endif
+    for(int i=0; i<n; i++)
+        check_node(nodes, i, v, first, nChildren);
+    size_t len=0;
+    for(const LLTree::Node* r=tree.root(); r; r=r->sibling, ++len)
+        if(r->parent || len>=nodes.size()) {
+            violation(v, STRUCTURE, r-&nodes[0], first);
+            break;
+        }
+    if(nChildren+len != nodes.size())
+        violation(v, STRUCTURE, 0, first);
+
+    if(v.count[STRUCTURE] == 0) // Nesting needs a valid structure
+        check_rows(nodes, std::max(rowStep,1), v, first);
+
+    for(int i=0; i<NB_INVARIANTS; i++)
+        if(v.count[i])
+            v.example[i] = &nodes[first[i]];
+    return v;
+}
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file validate.h
+ * @brief Check invariants of the tree of level lines
+ *
+ * (C) 2025, Pascal Monasse <pascal.monasse@enpc.fr>
+ */
+
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include "lltree.h"
+
+/// Invariants of the tree of level lines.
+enum Invariant {
+    CLOSURE,   ///< Each line is closed
+    STRUCTURE, ///< Fields parent, child and sibling are consistent
+    TYPES,     ///< Leaves are extrema, levels increase inside a max...
+    NESTING,   ///< Lines do not cross and each one is inside its parent
+    NB_INVARIANTS
+};
+
+/// Number of violations of each invariant, and the first violating node.
+struct Validation {
+    size_t count[NB_INVARIANTS];
+    const LLTree::Node* example[NB_INVARIANTS];
+    bool ok() const;
+};
+
+std::ostream& operator<<(std::ostream& str, const Validation& v);
+
+Validation validate_tree(LLTree& tree, int rowStep=1);
+
+#endif